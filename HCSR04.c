@@ -8,7 +8,10 @@
 #include "HCSR04.h"
 
 // Project includes
+#include "clock.h"
 #include "constants.h"
+#include "profile.h"
+#include "utils.h"
 
 // C libraries
 #include <stdbool.h>
@@ -17,24 +20,172 @@
 // PIC Includes
 #include <htc.h>
 
+#if HCSR04_SENSORS > 2 && defined(PROFILE_PIN_REGION)
+#error "The third sensor's trigger is the profiling debug pin"
+#endif
+
+// Send at least a 10uS pulse on a trigger line
+#define HCSR04_PULSE(pin)   do { (pin) = 1; CLOCK_DELAY_US(15); (pin) = 0; } while (0)
+
+// Sensor pinged last, and the latest reading from each
+static uint8_t pinged = 0;
+static uint16_t readings[HCSR04_SENSORS];
+
+/*
+ * HCSR04_init
+ * 
+ * Start TIMER1 free-running at F_osc/4 (1us per count at 4MHz). CCP3 captures
+ * the ECHO edges on RA2 against it and CCP4 raises the timeout, so the pulse 
+ * is timed in hardware with one interrupt per edge.
+ * 
+ * Input: 
+ *      void
+ * 
+ * Output:  
+ *      void
+ */
+void HCSR04_init(void) {
+    uint8_t i;
+    
+    // Extra trigger lines
+#if HCSR04_SENSORS > 1
+    PIN_US_TRIGGER_2 = 0;
+    PIN_US_TRIGGER_2_TRIS = 0;
+#endif
+#if HCSR04_SENSORS > 2
+    PIN_US_TRIGGER_3 = 0;
+    PIN_US_TRIGGER_3_TRIS = 0;
+#endif
+    
+    for (i = 0; i < HCSR04_SENSORS; i++)
+        readings[i] = HCSR04_NO_READING;
+    pinged = HCSR04_SENSORS - 1;
+    
+    // Capture and compare modules are disabled until a trigger is sent
+    PIE3bits.CCP3IE = 0;
+    PIE3bits.CCP4IE = 0;
+    CCP3CONbits.CCP3M = HCSR04_CAPTURE_OFF;
+    CCP4CONbits.CCP4M = HCSR04_COMPARE_SW_INT;
+    
+    // The clock manager sets the source and prescaler so TIMER1 counts 
+    // microseconds at every clock speed
+    T1CONbits.T1OSCEN = 0;
+    T1CONbits.TMR1ON = 1;
+}
+
 /*
  * HCSR04_Trigger
  * 
- * Triggers the ultrasonic TRIGGER pin pulse.
- * Counts are then read by the external oscillator on TIMER1,
- * With the IOC_ISR registering the beginning and end of the ECHO result.
+ * Triggers the ultrasonic TRIGGER pin pulse of the next sensor in turn. Only
+ * one sensor is pinged per reading, so they don't hear each other and the 
+ * shared ECHO line only carries one pulse.
+ * Counts are then read from TIMER1 by CCP3, with the ISR registering the 
+ * beginning and end of the ECHO result. CCP4 times out a sensor that doesn't
+ * start an echo, so a missing one costs HCSR04_MAX_ECHO_START rather than 
+ * the whole wait for the reading.
  * 
  * Input: 
- *      A boolean to represent the power-saving state/mode
- *      This is necessary for the delay contained in the HCSR04 pulse
+ *      void
  * 
  * Output:  
  *      void
  * 
  */
 void HCSR04_Trigger(void) {
-    //Send at least a 10uS pulse on trigger line
-    PIN_US_TRIGGER = 1; //high
-    __delay_us(15);
-    PIN_US_TRIGGER = 0; //low
+    uint16_t timeout;
+    
+    // Arm the capture for the rising edge of the echo. The interrupt must be
+    // off while the mode changes to avoid a false capture.
+    PIE3bits.CCP3IE = 0;
+    CCP3CONbits.CCP3M = HCSR04_CAPTURE_RISING;
+    PIR3bits.CCP3IF = 0;
+    PIE3bits.CCP3IE = 1;
+    
+    // Give up if the echo doesn't start. This is armed before the pulse so 
+    // it is in place before the rising edge moves it on.
+    PIE3bits.CCP4IE = 0;
+    timeout = clock_timer1() + HCSR04_MAX_ECHO_START;
+    CCPR4H = (uint8_t) (timeout >> 8);
+    CCPR4L = (uint8_t) timeout;
+    PIR3bits.CCP4IF = 0;
+    PIE3bits.CCP4IE = 1;
+    
+    circular_increment_counter(&pinged, HCSR04_SENSORS);
+    
+    switch (pinged)
+    {
+#if HCSR04_SENSORS > 1
+        case 1:
+            HCSR04_PULSE(PIN_US_TRIGGER_2);
+            break;
+#endif
+#if HCSR04_SENSORS > 2
+        case 2:
+            HCSR04_PULSE(PIN_US_TRIGGER_3);
+            break;
+#endif
+        default:
+            HCSR04_PULSE(PIN_US_TRIGGER);
+            break;
+    }
+}
+
+/*
+ * HCSR04_Fuse
+ * 
+ * Keep the reading from the sensor pinged last, and combine it with the
+ * latest from the others. The others are up to HCSR04_SENSORS - 1 readings
+ * old, which keeps one ping per reading.
+ * 
+ * Input: 
+ *      reading     Echo time from the sensor pinged last
+ * 
+ * Output:  
+ *      The nearest valid reading, or the median, depending on HCSR04_FUSION.
+ *      The median is only taken once every sensor has a valid reading, as a
+ *      silent one would count as the furthest and pull it out to the far
+ *      one of the others. Until then it is the nearest too.
+ *      HCSR04_NO_READING if no sensor has a valid one.
+ */
+uint16_t HCSR04_Fuse(uint16_t reading) {
+#if HCSR04_SENSORS > 1
+    uint16_t nearest = HCSR04_NO_READING;
+    uint8_t i;
+#if HCSR04_FUSION == HCSR04_FUSE_MEDIAN
+    uint8_t valid = 0;
+#endif
+#endif
+    
+    readings[pinged] = reading;
+    
+#if HCSR04_SENSORS == 1
+    return reading;
+#else
+    for (i = 0; i < HCSR04_SENSORS; i++)
+    {
+        if (readings[i] == 0 || readings[i] > HCSR04_MAX_READING)
+            continue;
+        
+#if HCSR04_FUSION == HCSR04_FUSE_MEDIAN
+        valid++;
+#endif
+        if (readings[i] < nearest)
+            nearest = readings[i];
+    }
+    
+#if HCSR04_FUSION == HCSR04_FUSE_MEDIAN
+    if (valid == HCSR04_SENSORS)
+        return MEDIAN_N(HCSR04_SENSORS)(readings);
+#endif
+    return nearest;
+#endif
+}
+
+/*
+ * HCSR04_Missed
+ * 
+ * The sensor pinged last didn't answer, so leave it out until it does.
+ */
+void HCSR04_Missed(void) {
+    readings[pinged] = HCSR04_NO_READING;
 }
\ No newline at end of file
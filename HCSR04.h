@@ -1,6 +1,53 @@
 #ifndef HCSR04_H
 #define	HCSR04_H
 
-void HCSR04_Trigger();
+#include <stdint.h>
+
+// Echo pulse length in microseconds per centimetre of distance
+#define HCSR04_US_PER_CM        58
+#define HCSR04_CM(cm)           ((uint16_t) ((cm) * HCSR04_US_PER_CM))
+
+// Longest echo accepted before the reading times out (~4.4m)
+#define HCSR04_MAX_READING      HCSR04_CM(440)
+
+// Reading kept for a sensor that timed out or didn't answer
+#define HCSR04_NO_READING       (HCSR04_MAX_READING + 1)
+
+// Longest wait from the trigger for the echo to start, in microseconds. The
+// HC-SR04 raises it about 0.5ms after the trigger, even with nothing in 
+// range, so a sensor that hasn't by then is missing.
+#define HCSR04_MAX_ECHO_START   2000
+
+// Number of sensors, pinged in turn, 1 to 3
+#ifndef HCSR04_SENSORS
+#define HCSR04_SENSORS          1
+#endif
+
+#if HCSR04_SENSORS < 1 || HCSR04_SENSORS > 3
+#error "HCSR04_SENSORS must be 1, 2 or 3"
+#endif
+
+// How the latest reading from each sensor is combined into one
+#define HCSR04_FUSE_NEAREST     0   // Nearest valid reading
+#define HCSR04_FUSE_MEDIAN      1   // Median, which needs an odd count
+
+#ifndef HCSR04_FUSION
+#define HCSR04_FUSION           HCSR04_FUSE_NEAREST
+#endif
+
+#if HCSR04_FUSION == HCSR04_FUSE_MEDIAN && (HCSR04_SENSORS % 2) == 0
+#error "HCSR04_FUSE_MEDIAN needs an odd number of sensors"
+#endif
+
+// CCP3 modes used to time the echo on RA2
+#define HCSR04_CAPTURE_OFF      0b0000
+#define HCSR04_CAPTURE_FALLING  0b0100
+#define HCSR04_CAPTURE_RISING   0b0101
+#define HCSR04_COMPARE_SW_INT   0b1010
+
+void HCSR04_init(void);
+void HCSR04_Trigger(void);
+uint16_t HCSR04_Fuse(uint16_t reading);
+void HCSR04_Missed(void);
 
 #endif	/* HCSR04_H */
@@ -9,6 +9,7 @@
 
 // Project includes
 #include "constants.h"
+#include "profile.h"
 
 // C libraries
 #include <stdbool.h>
@@ -17,6 +18,60 @@
 // PIC Includes
 #include <htc.h>
 
+// Logical LED on each driver output. Fails to compile unless LIGHT_MAP has
+// exactly one entry per output.
+static const uint8_t lightMap[] = LIGHT_MAP;
+typedef char TLC5926_LightMapSize[sizeof(lightMap) == TLC5926_OUTPUTS ? 1 : -1];
+
+// Bitmap mask for each logical LED, as PIC16 shifts by a variable one bit at
+// a time
+static const uint16_t lightMask[16] = {
+    0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+    0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000
+};
+
+// Frame built by TLC5926_SetLights()
+static uint8_t lightsFrame[TLC5926_FRAME_BYTES];
+
+// The bitmap currently held in the output latch
+static uint16_t latchedBitmap = LIGHT_OFF;
+static bool latchedValid = false;
+
+// The brightness currently shown on NOT_OE
+static uint8_t currentBrightness = TLC5926_BRIGHTNESS_OFF;
+
+#if TLC5926_USE_MSSP
+/*
+ * TLC5926_SpiEnable
+ * 
+ * Configure MSSP1 as an SPI master at F_osc/4. Data is changed on the falling
+ * edge of CLK so it is stable when the TLC5926 samples on the rising edge.
+ */
+static void TLC5926_SpiEnable(void) {
+    LATBbits.LATB6 = IO_LOW;
+    TRISBbits.TRISB6 = 0;   // SCK1 output
+    TRISCbits.TRISC7 = 0;   // SDO1 output
+    
+    SSP1STATbits.SMP = 0;
+    SSP1STATbits.CKE = 1;
+    SSP1CON1bits.CKP = 0;
+    SSP1CON1bits.SSPM = 0b0000;
+    SSP1CON1bits.SSPEN = 1;
+}
+
+/*
+ * TLC5926_SpiWrite
+ * 
+ * Shift one byte out MSB first and wait for it to complete.
+ */
+static void TLC5926_SpiWrite(uint8_t data) {
+    PIR1bits.SSP1IF = 0;
+    SSP1BUF = data;
+    while (PIR1bits.SSP1IF == 0)
+        ;
+}
+#endif
+
 /*
  * TLC5926_init
  * 
@@ -35,53 +90,207 @@ void TLC5926_init(void) {
     PIN_LED_LE = IO_LOW;
     // This is NOT_OE, so drive it high to turn LED's off.
     PIN_LED_OE = IO_HIGH; 
+    
+    latchedValid = false;
+    currentBrightness = TLC5926_BRIGHTNESS_OFF;
 }
 
 /*
- * TLC5926_SetLights
+ * TLC5926_SetBrightness
  * 
- * Change the lights that are enabled. PIN_LE_OE must be LOW to turn leds on.
+ * Set the LED brightness by modulating NOT_OE. Fully off and fully on drive 
+ * the pin from the port latch with TIMER2 stopped; anything in between is 
+ * generated in hardware at F_osc/4 / 64 with 8 bits of resolution. That 
+ * follows the clock speed, from ~3.9kHz at CLOCK_SLOW, where dimmed waits 
+ * run, to 62.5kHz at CLOCK_FAST, all well above visible flicker.
+ * 
+ * Note that the PWM stops while the device sleeps, leaving the LEDs in 
+ * whatever state the pin was in.
  * 
  * Inputs: 
- *      bitmap  bit 0 corresponds to LED0, bit 15 to LED15
+ *      duty    LED on-time out of 255
  * 
  * Output:
  *      void
+ */
+void TLC5926_SetBrightness(uint8_t duty) {
+    if (duty == currentBrightness)
+        return;
+    
+    if (duty == TLC5926_BRIGHTNESS_OFF || duty == TLC5926_BRIGHTNESS_FULL)
+    {
+        // Hand the pin back to the port latch and stop the timebase
+        PSTR1CONbits.STR1B = 0;
+        CCP1CONbits.CCP1M = 0b0000;
+        T2CONbits.TMR2ON = 0;
+        
+        if (duty == TLC5926_BRIGHTNESS_OFF)
+            PIN_LED_OE = IO_HIGH;
+        else
+            PIN_LED_OE = IO_LOW;
+    }
+    else
+    {
+        // Duty cycle is CCPR1L:DC1B, out of 4 * (PR2 + 1)
+        CCPR1L = duty >> 2;
+        CCP1CONbits.DC1B = duty & 0x03;
+        
+        if (CCP1CONbits.CCP1M != TLC5926_PWM_MODE)
+        {
+            PR2 = 63;
+            T2CONbits.T2CKPS = 0b00;
+            TMR2 = 0;
+            
+            // Single output, steered only to P1B so RC5, RC3 and RC2 remain
+            // port pins.
+            CCP1CONbits.P1M = 0b00;
+            CCP1CONbits.CCP1M = TLC5926_PWM_MODE;
+            PSTR1CON = 0x00;
+            PSTR1CONbits.STR1SYNC = 1;
+            T2CONbits.TMR2ON = 1;
+            PSTR1CONbits.STR1B = 1;
+        }
+    }
+    
+    currentBrightness = duty;
+}
+
+/*
+ * TLC5926_IsDimmed
  * 
- * TODO: Check the bitmap code actually matches the documentation
+ * Output:
+ *      true while NOT_OE is being driven by the PWM, which stops in SLEEP.
  */
-void TLC5926_SetLights(uint16_t bitmap) {
+bool TLC5926_IsDimmed(void) {
+    return currentBrightness != TLC5926_BRIGHTNESS_OFF && 
+            currentBrightness != TLC5926_BRIGHTNESS_FULL;
+}
+
+/*
+ * TLC5926_Shutdown
+ * 
+ * Call before power is removed from the LED driver. The latched bitmap is
+ * forgotten so the next TLC5926_SetLights() always shifts out, and the data
+ * lines are driven low so they don't back-power the driver.
+ * 
+ * Inputs: 
+ *      void
+ * 
+ * Output:
+ *      void
+ */
+void TLC5926_Shutdown(void) {
+#if TLC5926_USE_MSSP
+    SSP1CON1bits.SSPEN = 0;
+#endif
+    PIN_LED_SDI = IO_LOW;
+    PIN_LED_CLK = IO_LOW;
+    PIN_LED_LE = IO_LOW;
+    
+    latchedValid = false;
+}
+
+/*
+ * TLC5926_Shift
+ * 
+ * Shift one byte into the chain, MSB first. The TLC5926 needs 20ns of clock
+ * pulse width and 15ns of data setup, well inside one instruction cycle, so
+ * the edges are driven back to back.
+ */
+static void TLC5926_Shift(uint8_t data) {
+#if TLC5926_USE_MSSP
+    TLC5926_SpiWrite(data);
+#else
     uint_fast8_t i;
     
-    // Send 16 pulses
-    for (i = 0; i < 16; i++) {
-        
-        // Set the data line
-        if (bitmap & (uint16_t) (1 << (15 - i)))
+    for (i = 0; i < 8; i++) {
+        if (data & 0x80)
             PIN_LED_SDI = IO_HIGH;
         else
             PIN_LED_SDI = IO_LOW;
         
-        // Trigger a rising edge
-        __delay_us(TLC5926_US_DELAY);
         PIN_LED_CLK = IO_HIGH;
-        
-        // Drive the data line low
-        // TODO: Is this even necessary?
-        //__delay_us(TLC5926_US_DELAY);
-        //PIN_LED_SDI = IO_LOW;
-        
-        // Trigger a falling edge
-        __delay_us(TLC5926_US_DELAY);
-        PIN_LED_CLK = IO_LOW;        
+        PIN_LED_CLK = IO_LOW;
+        data <<= 1;
     }
+#endif
+}
+
+/*
+ * TLC5926_ShowFrame
+ * 
+ * Shift a whole frame out to the chain in one burst and latch it onto every
+ * driver at once. The last output goes first, so it has travelled through
+ * to the far end of the chain when the latch is pulsed.
+ * 
+ * Inputs: 
+ *      frame   TLC5926_FRAME_BYTES bytes, output n in bit (n % 8) of byte 
+ *              (n / 8)
+ * 
+ * Output:
+ *      void
+ */
+void TLC5926_ShowFrame(const uint8_t *frame) {
+    uint_fast8_t i;
+    
+#if TLC5926_USE_MSSP
+    if (SSP1CON1bits.SSPEN == 0)
+        TLC5926_SpiEnable();
+#endif
+    
+    for (i = TLC5926_FRAME_BYTES; i > 0; i--)
+        TLC5926_Shift(frame[i - 1]);
     
     // Make sure everything is off
     PIN_LED_SDI = IO_LOW;
-    PIN_LED_CLK = IO_LOW;
     
-    // Save the data to the latch
+    // Save the data to the latch. The minimum LE pulse is 20ns, so one 
+    // instruction cycle is plenty.
     PIN_LED_LE = IO_HIGH;
-    __delay_us(TLC5926_US_DELAY);
     PIN_LED_LE = IO_LOW;
+    
+    // The frame may not be one TLC5926_SetLights() would build
+    latchedValid = false;
+}
+
+/*
+ * TLC5926_SetLights
+ * 
+ * Change the lights that are enabled. PIN_LE_OE must be LOW to turn leds on.
+ * The bitmap is spread over the chain by LIGHT_MAP, and nothing is sent if it 
+ * is already latched.
+ * 
+ * Inputs: 
+ *      bitmap  bit 0 corresponds to logical LED0, bit 15 to LED15
+ * 
+ * Output:
+ *      void
+ */
+void TLC5926_SetLights(uint16_t bitmap) {
+    uint_fast8_t i;
+    uint8_t led;
+    uint8_t data = 0;
+    
+    if (latchedValid == true && latchedBitmap == bitmap)
+        return;
+    
+    PROFILE_BEGIN(PROFILE_SET_LIGHTS);
+    
+    // Build each byte from its highest output down
+    for (i = TLC5926_OUTPUTS; i > 0; i--) {
+        led = lightMap[i - 1];
+        data <<= 1;
+        if (led != LIGHT_UNUSED && (bitmap & lightMask[led]))
+            data |= 0x01;
+        
+        if (((i - 1) & 0x07) == 0)
+            lightsFrame[(i - 1) >> 3] = data;
+    }
+    
+    TLC5926_ShowFrame(lightsFrame);
+    
+    latchedBitmap = bitmap;
+    latchedValid = true;
+    
+    PROFILE_END(PROFILE_SET_LIGHTS);
 }
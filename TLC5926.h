@@ -1,11 +1,40 @@
 #ifndef TLC5926_H
 #define	TLC5926_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-#define TLC5926_US_DELAY   10
+// Number of TLC5926's daisy-chained from SDO to SDI, each with 16 outputs
+#ifndef TLC5926_CHAIN
+#define TLC5926_CHAIN      1
+#endif
+
+#define TLC5926_OUTPUTS    (16 * TLC5926_CHAIN)
+
+// A frame holds one bit per output, output n in bit (n % 8) of byte (n / 8)
+#define TLC5926_FRAME_BYTES (TLC5926_OUTPUTS / 8)
+
+// Select the MSSP (hardware SPI) backend instead of bit-banging the GPIO.
+// This needs the CLK line routed to SCK1 (RB6) rather than RC6, SDI stays on 
+// SDO1 (RC7). SDI1 shares RB4 with the yellow button, which is only ever read
+// as an input so the shifted-in data is ignored.
+#ifndef TLC5926_USE_MSSP
+#define TLC5926_USE_MSSP   0
+#endif
+
+// Brightness limits. Anything in between is generated by ECCP1 PWM on P1B 
+// (NOT_OE, RC4) with TIMER2 as the timebase.
+#define TLC5926_BRIGHTNESS_OFF  0
+#define TLC5926_BRIGHTNESS_FULL 255
+
+// PWM mode with P1B active-low, so the duty cycle is the LED on-time
+#define TLC5926_PWM_MODE        0b1101
 
 void TLC5926_init(void);
 void TLC5926_SetLights(uint16_t bitmap);
+void TLC5926_ShowFrame(const uint8_t *frame);
+void TLC5926_SetBrightness(uint8_t duty);
+bool TLC5926_IsDimmed(void);
+void TLC5926_Shutdown(void);
 
 #endif	/* TLC5926_H */
@@ -0,0 +1,178 @@
+/* 
+ * File:   battery.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:26 AM
+ * 
+ * Battery fuel gauge. The battery (AN5) and the fixed voltage reference are 
+ * both converted against Vdd, and the ratio of the two gives the battery 
+ * voltage independent of Vdd sagging.
+ */
+
+#include "battery.h"
+
+// Project includes
+#include "clock.h"
+#include "constants.h"
+#include "event.h"
+#include "power.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+// Remaining capacity against voltage, highest first. Tune for the chemistry.
+typedef struct
+{
+    uint16_t millivolts;
+    uint8_t percent;
+} battery_point;
+
+static const battery_point capacityCurve[] = {
+    {3300, 100},
+    {3150, 75},
+    {3050, 50},
+    {2950, 25},
+    {2830, 10},
+    {2700, 0},
+};
+
+#define CAPACITY_POINTS (sizeof(capacityCurve) / sizeof(capacityCurve[0]))
+
+static uint16_t lastMillivolts = 0;
+static uint8_t lastPercent = 0;
+
+/*
+ * battery_convert
+ * 
+ * Oversample one ADC channel. Each conversion runs from FRC with the core 
+ * asleep, unless the UART is still transmitting.
+ * 
+ * Input:
+ *      channel     ADC channel to convert
+ * 
+ * Output:
+ *      Decimated result with BATTERY_OVERSAMPLE_BITS extra bits
+ */
+static uint16_t battery_convert(uint8_t channel)
+{
+    uint16_t sum = 0;
+    uint8_t i;
+    
+    ADCON0bits.CHS = channel;
+    // Acquisition time after changing channel
+    CLOCK_DELAY_US(5);
+    
+    for (i = 0; i < BATTERY_SAMPLES; i++)
+    {
+        PIR1bits.ADIF = 0;
+        PIE1bits.ADIE = 1;
+        ADCON0bits.GO_nDONE = 1;
+        
+        // ADIF wakes the core, and the ISR disables ADIE again
+        while (event_take(EVENT_ADC) == false)
+            event_sleep();
+        
+        sum += (uint16_t) ((ADRESHbits.ADRESH << 8) | ADRESLbits.ADRESL);
+    }
+    
+    return sum >> BATTERY_OVERSAMPLE_BITS;
+}
+
+/*
+ * battery_estimate_percent
+ * 
+ * Interpolate the remaining capacity from the capacity curve.
+ */
+static uint8_t battery_estimate_percent(uint16_t millivolts)
+{
+    uint8_t i;
+    uint16_t span;
+    
+    if (millivolts >= capacityCurve[0].millivolts)
+        return capacityCurve[0].percent;
+    
+    for (i = 1; i < CAPACITY_POINTS; i++)
+    {
+        if (millivolts >= capacityCurve[i].millivolts)
+        {
+            span = capacityCurve[i - 1].millivolts - capacityCurve[i].millivolts;
+            return capacityCurve[i].percent + (uint8_t) (
+                    ((uint32_t) (millivolts - capacityCurve[i].millivolts) * 
+                    (capacityCurve[i - 1].percent - capacityCurve[i].percent)) / span);
+        }
+    }
+    
+    return capacityCurve[CAPACITY_POINTS - 1].percent;
+}
+
+/*
+ * battery_init
+ * 
+ * Configure the ADC pin. The ADC and reference are the POWER_ADC domain, so 
+ * stay off between measurements.
+ */
+void battery_init(void)
+{
+    ANSELCbits.ANSC1 = 1;               // RC1 is AN5
+    
+    ADCON1bits.ADCS = 0b111;            // FRC, so conversions run in SLEEP
+    ADCON1bits.ADNREF = 0;              // V_ref- is connected to Vss
+    ADCON1bits.ADPREF = 0;              // V_ref+ is connected to Vdd
+    ADCON1bits.ADFM = 1;                // Right justify A/D result 
+    FVRCONbits.ADFVR = 0b01;            // 1.024V on buffer 1
+}
+
+/*
+ * battery_measure
+ * 
+ * Measure the battery. POWER_ADC is only acquired for the measurement.
+ * 
+ * Output:
+ *      Battery voltage in millivolts
+ */
+uint16_t battery_measure(void)
+{
+    uint16_t reference;
+    uint16_t battery;
+    
+    power_acquire(POWER_ADC);
+    reference = battery_convert(BATTERY_CHANNEL_FVR);
+    battery = battery_convert(BATTERY_CHANNEL_AN5);
+    power_release(POWER_ADC);
+    
+    if (reference == 0)
+        return lastMillivolts;
+    
+    lastMillivolts = (uint16_t) (((uint32_t) BATTERY_FVR_MV * battery * 
+            BATTERY_DIVIDER_NUM) / ((uint32_t) reference * BATTERY_DIVIDER_DEN));
+    lastPercent = battery_estimate_percent(lastMillivolts);
+    
+    return lastMillivolts;
+}
+
+/*
+ * battery_millivolts
+ * 
+ * Output:
+ *      Battery voltage from the last measurement
+ */
+uint16_t battery_millivolts(void)
+{
+    return lastMillivolts;
+}
+
+/*
+ * battery_percent
+ * 
+ * Output:
+ *      Estimated remaining capacity from the last measurement
+ */
+uint8_t battery_percent(void)
+{
+    return lastPercent;
+}
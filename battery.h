@@ -0,0 +1,34 @@
+/* 
+ * File:   battery.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:26 AM
+ */
+
+#ifndef BATTERY_H
+#define	BATTERY_H
+
+#include <stdint.h>
+
+// Each result is the sum of 4^n conversions decimated by 2^n, for n extra 
+// bits of resolution (12 bits with n = 2).
+#define BATTERY_OVERSAMPLE_BITS 2
+#define BATTERY_SAMPLES         (1 << (2 * BATTERY_OVERSAMPLE_BITS))
+
+// Fixed voltage reference buffer 1 output, 1.024V
+#define BATTERY_FVR_MV          1024
+
+// Divider between the battery and RC1/AN5, as battery/pin
+#define BATTERY_DIVIDER_NUM     1
+#define BATTERY_DIVIDER_DEN     1
+
+// ADC channels
+#define BATTERY_CHANNEL_AN5     0b00101
+#define BATTERY_CHANNEL_FVR     0b11111
+
+void battery_init(void);
+uint16_t battery_measure(void);
+uint16_t battery_millivolts(void);
+uint8_t battery_percent(void);
+
+#endif	/* BATTERY_H */
@@ -0,0 +1,133 @@
+/*
+ * File:   clock.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:55 AM
+ *
+ * System clock manager. Processing runs fast so the core gets back to SLEEP
+ * sooner, and waits that can't sleep (an echo being timed, PWM dimming, the
+ * UART) run slow. HFINTOSC keeps running between speeds, so a change takes 
+ * effect at once. TIMER1 is re-prescaled to keep counting microseconds and
+ * the UART baud rate is reloaded, so echo timing, the event timer and 
+ * telemetry are right at every speed.
+ * 
+ * LFINTOSC (31kHz) isn't used. TIMER1 can't count microseconds from it and 
+ * the UART can't reach 19200 baud, and processing at 31kHz costs more charge
+ * than the same work done fast.
+ */
+
+#include "clock.h"
+
+// Project includes
+#include "telemetry.h"
+#include "uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+// HFINTOSC selected by IRCF
+#define CLOCK_SCS_INTERNAL  0b10
+
+typedef struct
+{
+    uint8_t ircf;           // OSCCON IRCF
+    uint8_t timerSource;    // T1CON TMR1CS
+    uint8_t timerPrescale;  // T1CON T1CKPS
+    uint16_t brg;           // SPBRG with BRG16 and BRGH set
+} clock_setting;
+
+// Indexed by CLOCK_*. TIMER1 is 1MHz in each.
+static const clock_setting clockSettings[CLOCK_SPEEDS] = {
+    // CLOCK_1MHZ, TIMER1 from F_osc
+    {0b1011, 0b01, 0b00, UART_BRG(1000000, TELEMETRY_BAUD_RATE)},
+    // CLOCK_4MHZ, TIMER1 from F_osc/4
+    {0b1101, 0b00, 0b00, UART_BRG(4000000, TELEMETRY_BAUD_RATE)},
+    // CLOCK_16MHZ, TIMER1 from F_osc/4 with a 1:4 prescaler
+    {0b1111, 0b00, 0b10, UART_BRG(16000000, TELEMETRY_BAUD_RATE)},
+};
+
+uint8_t clockSpeed = CLOCK_4MHZ;
+
+/*
+ * clock_apply
+ * 
+ * Switch to a speed. TIMER1 and the oscillator change together with 
+ * interrupts off, so the ISR never sees TIMER1 at the wrong rate.
+ */
+static void clock_apply(uint8_t speed)
+{
+    const clock_setting *setting = &clockSettings[speed];
+    
+    di();
+    T1CONbits.TMR1CS = setting->timerSource;
+    T1CONbits.T1CKPS = setting->timerPrescale;
+    OSCCONbits.IRCF = setting->ircf;
+    UART_set_brg(setting->brg);
+    clockSpeed = speed;
+    ei();
+}
+
+/*
+ * clock_init
+ * 
+ * Run from HFINTOSC at CLOCK_4MHZ, so __delay_*() are right through the rest
+ * of init().
+ */
+void clock_init(void)
+{
+    OSCCONbits.SCS = CLOCK_SCS_INTERNAL;
+    clock_apply(CLOCK_4MHZ);
+}
+
+/*
+ * clock_set
+ * 
+ * Change the system clock speed. The speed is left as it is while the UART
+ * is sending, as changing the baud rate part way through would corrupt the
+ * byte, and always when built without CLOCK_SCALING. Everything that depends
+ * on the clock is right at any speed, so the caller can carry on either way.
+ * 
+ * Input:
+ *      speed   CLOCK_*
+ * 
+ * Output:
+ *      true if the clock is now at that speed
+ */
+bool clock_set(uint8_t speed)
+{
+    if (speed == clockSpeed)
+        return true;
+    
+    if (CLOCK_SCALING == 0 || UART_tx_idle() == false)
+        return false;
+    
+    clock_apply(speed);
+    return true;
+}
+
+/*
+ * clock_timer1
+ *
+ * Read TIMER1 without tearing the two halves.
+ * 
+ * Output:
+ *      TIMER1 in microseconds
+ */
+uint16_t clock_timer1(void)
+{
+    uint8_t high;
+    uint8_t low;
+
+    do
+    {
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H);
+
+    return ((uint16_t) high << 8) | low;
+}
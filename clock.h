@@ -0,0 +1,51 @@
+/* 
+ * File:   clock.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:55 AM
+ */
+
+#ifndef CLOCK_H
+#define	CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// System clock speeds, all from HFINTOSC
+#define CLOCK_1MHZ      0   // Waits that have to stay awake
+#define CLOCK_4MHZ      1   // _XTAL_FREQ, and the speed at reset
+#define CLOCK_16MHZ     2   // Bursts of processing between waits
+#define CLOCK_SPEEDS    3
+
+#define CLOCK_SLOW      CLOCK_1MHZ
+#define CLOCK_FAST      CLOCK_16MHZ
+
+// Set to 0 to stay at CLOCK_4MHZ, where an instruction cycle is a 
+// microsecond. tools/bench builds this way so cycle counts are comparable.
+#ifndef CLOCK_SCALING
+#define CLOCK_SCALING   1
+#endif
+
+extern uint8_t clockSpeed;
+
+/*
+ * CLOCK_DELAY_US
+ * 
+ * Busy wait that is right at the current clock speed. __delay_us() and 
+ * __delay_ms() count cycles of _XTAL_FREQ, so are only right at CLOCK_4MHZ.
+ * The time must be a constant.
+ */
+#define CLOCK_DELAY_US(us)  do { \
+        if (clockSpeed == CLOCK_16MHZ) \
+            _delay((unsigned long) (us) * 4); \
+        else if (clockSpeed == CLOCK_4MHZ) \
+            _delay(us); \
+        else \
+            _delay(((us) + 3) / 4); \
+    } while (0)
+
+void clock_init(void);
+bool clock_set(uint8_t speed);
+uint16_t clock_timer1(void);
+
+#endif	/* CLOCK_H */
@@ -20,8 +20,13 @@
 // Analogue battery check
 #define PIN_BATTERY             RC1
 
-// HCSR04 Pins
+// HCSR04 Pins. Extra sensors each have their own trigger, and share the 
+// ECHO pin through a diode OR.
 #define PIN_US_TRIGGER          LATCbits.LATC2
+#define PIN_US_TRIGGER_2        LATAbits.LATA4
+#define PIN_US_TRIGGER_2_TRIS   TRISAbits.TRISA4
+#define PIN_US_TRIGGER_3        LATAbits.LATA5
+#define PIN_US_TRIGGER_3_TRIS   TRISAbits.TRISA5
 #define PIN_US_ECHO             RA2
 
 // TLC5926 Pins
@@ -30,12 +35,26 @@
 #define PIN_LED_LE              LATCbits.LATC3
 #define PIN_LED_OE              LATCbits.LATC4
 
-// LED Array colour bitmap values
-#define LIGHT_RED               0x001F
-#define LIGHT_YELLOW            0x7C00
-#define LIGHT_GREEN             0x03E0
+// LED Array colour bitmap values. Each bit is a logical LED along the bar,
+// which LIGHT_MAP places on the driver outputs.
+#define LIGHT_LED(led)          (1u << (led))
+#define LIGHT_SPAN(first, n)    (((1u << (n)) - 1u) << (first))
+#define LIGHT_RED               LIGHT_SPAN(0, 5)
+#define LIGHT_GREEN             LIGHT_SPAN(5, 5)
+#define LIGHT_YELLOW            LIGHT_SPAN(10, 5)
 #define LIGHT_OFF               0x0000
-#define LIGHT_CENTERS           0x2044
+#define LIGHT_CENTERS           (LIGHT_LED(2) | LIGHT_LED(6) | LIGHT_LED(13))
+
+// Logical LED shown on each driver output, from OUT0 of the TLC5926 nearest
+// the PIC to OUT15 of the last one in the chain. A logical LED may be used on 
+// more than one output, e.g. once for each bay, and LIGHT_UNUSED leaves an
+// output off. Define LIGHT_MAP to match the board when TLC5926_CHAIN > 1.
+#define LIGHT_UNUSED            0xFF
+#define LIGHT_MAP_BAR           0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, \
+                                14, LIGHT_UNUSED
+#ifndef LIGHT_MAP
+#define LIGHT_MAP               { LIGHT_MAP_BAR }
+#endif
 
 #define LIGHT_THRESH_OFFSET     2
 
@@ -43,6 +62,9 @@
 #define BTN_SET_YELLOW          RB4
 #define BTN_SET_RED             RB5
 
+// WDTCON value for a typical period of 2^ps milliseconds, with SWDTEN set
+#define WATCHDOG_PERIOD(ps)     ((uint8_t) (((ps) << 1) | 0x01))
+
 #define WATCHDOG_MAX_256S		0b00100101
 #define WATCHDOG_TYP_512MS		0b00010011
 
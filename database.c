@@ -6,36 +6,86 @@
  */
 
 #include "database.h"
+#include "profile.h"
+#include "utils.h"
 
+#if DATABASE_CHECKSUM == DATABASE_CHECKSUM_SUM
 #define CALC_CHECKSUM(tdb) chcksum(tdb.serialised + DATABASE_CHECKSUM_OFFSET, \
     DATABASE_LENGTH - DATABASE_CHECKSUM_OFFSET, DATABASE_SEED)
+#else
+#define CALC_CHECKSUM(tdb) crc16(tdb.serialised + DATABASE_CHECKSUM_OFFSET, \
+    DATABASE_LENGTH - DATABASE_CHECKSUM_OFFSET, DATABASE_SEED)
+#endif
 
 database db;
 
+// Slot holding the newest record, and whether it is valid
+static uint8_t dbSlot = DATABASE_SLOTS - 1;
+static bool dbSlotValid = false;
+
+// CRC-16-CCITT (polynomial 0x1021), one entry per nibble
+static const uint16_t crc16Table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+ * crc16
+ * 
+ * Calculate a CRC-16-CCITT, MSB first, four bits at a time from a 16 entry
+ * table in program memory. With a seed of 0xFFFF this is CRC-16/CCITT-FALSE 
+ * ("123456789" gives 0x29B1).
+ * 
+ * Input:
+ *      array   Array of data to build checksum
+ *      len     Length of the array
+ *      seed    Initial CRC value
+ * 
+ * Output:
+ *      Checksum
+ */
+uint16_t crc16(uint8_t *array, size_t len, uint16_t seed)
+{
+    uint_fast16_t i;
+    uint16_t crc;
+    
+    crc = seed;
+    for (i = 0; i < len; i++)
+    {
+        crc = (uint16_t) (crc << 4) ^ crc16Table[(uint8_t) (crc >> 12) ^ (*array >> 4)];
+        crc = (uint16_t) (crc << 4) ^ crc16Table[(uint8_t) (crc >> 12) ^ (*array & 0x0F)];
+        array++;
+    }
+    
+    return crc;
+}
+
+#if DATABASE_CHECKSUM == DATABASE_CHECKSUM_SUM
 /*
- * checksum
+ * chcksum
  * 
- * Calculate a CRC checksum, where modulo is UINT16_MAX
+ * The additive sum the CRC replaced, for the bench only.
  * 
  * Input:
  *      array   Array of data to build checksum
  *      len     Length of the array
- *      seed    Seed to use. See https://users.ece.cmu.edu/~koopman/crc/
+ *      seed    Initial sum
  * 
  * Output:
  *      Checksum
  */
-uint16_t chcksum(uint8_t *array, size_t len, uint16_t seed)
+static uint16_t chcksum(uint8_t *array, size_t len, uint16_t seed)
 {
     uint_fast16_t i;
     uint16_t chk;
     
-    chk = (uint16_t) seed;
+    chk = seed;
     for (i = 0; i < len; i++)
         chk += *array++;
     
     return chk;
 }
+#endif
 
 /*
  * db_write
@@ -47,7 +97,7 @@ void db_write(uint16_t location)
 {
     uint_fast16_t i;
     
-    //TODO: Do we need to bump the watchdog while we're in here?
+    // At most DATABASE_LENGTH writes of up to 5ms, well inside the watchdog
     for (i = 0; i < DATABASE_LENGTH; i++)
         if (eeprom_read_register((uint16_t) (location + i)) != db.serialised[i])
             eeprom_write_register((uint16_t) (location + i), db.serialised[i]);
@@ -65,23 +115,62 @@ bool db_read(uint16_t location)
 {
     uint_fast16_t i;
     
-    //TODO: Do we need to bump the watchdog while we're in here?
     for (i = 0; i < DATABASE_LENGTH; i++)
         db.serialised[i] = eeprom_read_register((uint16_t) (location + i));
     
     return db.sdb.checksum == CALC_CHECKSUM(db);        
 }
 
+/*
+ * db_unchanged
+ * 
+ * Check whether the newest record already holds the current settings, so a
+ * save can be skipped.
+ */
+static bool db_unchanged(void) {
+    uint_fast16_t i;
+    uint16_t location = DATABASE_SLOT_LOC(dbSlot);
+    
+    if (dbSlotValid == false)
+        return false;
+    
+    for (i = offsetof(database, sdb.rangePointRed); i < DATABASE_LENGTH; i++)
+        if (eeprom_read_register((uint16_t) (location + i)) != db.serialised[i])
+            return false;
+    
+    return true;
+}
+
 /*
  * db_save
  * 
- * Update the checksum and save the database to both locations.
+ * Append the database to the next slot of the ring with the next sequence 
+ * number. Nothing is written if the settings haven't changed.
  */
 void db_save(void) {
-    db.sdb.checksum = CALC_CHECKSUM(db);
+    PROFILE_BEGIN(PROFILE_DB_SAVE);
+    
+    if (db_unchanged() == false)
+    {
+        circular_increment_counter(&dbSlot, DATABASE_SLOTS);
+        db.sdb.sequence++;
+        db.sdb.checksum = CALC_CHECKSUM(db);
+        
+        db_write(DATABASE_SLOT_LOC(dbSlot));
+        dbSlotValid = true;
+    }
     
-    db_write(DATABASE_MEM_LOC_1);
-    db_write(DATABASE_MEM_LOC_2);
+    PROFILE_END(PROFILE_DB_SAVE);
+}
+
+/*
+ * db_defaults
+ * 
+ * Load the default settings into RAM.
+ */
+static void db_defaults(void) {
+    db.sdb.rangePointRed = DEFAULT_RANGE_POINT_1;
+    db.sdb.rangePointYellow = DEFAULT_RANGE_POINT_2;
 }
 
 /*
@@ -90,27 +179,45 @@ void db_save(void) {
  * Reset the database with defaults.
  */
 void db_reset(void) {
-    db.sdb.rangePointRed = DEFAULT_RANGE_POINT_1;
-    db.sdb.rangePointYellow = DEFAULT_RANGE_POINT_2;
-    
+    db_defaults();
     db_save();
 }
 
 /*
- * Read from one memory location. If it is valid, write to the other.
- * If both fail, reset the database and return false so the application can 
- * handle it.
+ * Scan every slot once and load the valid record with the newest sequence 
+ * number. Nothing is written. If no record is valid, the defaults are loaded 
+ * and false is returned so the application can handle it; they are only 
+ * written by the next save.
  */
 bool db_init(void) {
-    if (db_read(DATABASE_MEM_LOC_1) == true)
-        db_write(DATABASE_MEM_LOC_2);
-    else if (db_read(DATABASE_MEM_LOC_2) == true)
-        db_write(DATABASE_MEM_LOC_1);
-    else
+    uint8_t slot;
+    uint16_t newestSequence = 0;
+    
+    dbSlotValid = false;
+    
+    for (slot = 0; slot < DATABASE_SLOTS; slot++)
+    {
+        if (db_read(DATABASE_SLOT_LOC(slot)) == false)
+            continue;
+        
+        // Sequence numbers wrap, so compare by difference
+        if (dbSlotValid == false || 
+                (int16_t) (db.sdb.sequence - newestSequence) > 0)
+        {
+            dbSlot = slot;
+            newestSequence = db.sdb.sequence;
+            dbSlotValid = true;
+        }
+    }
+    
+    if (dbSlotValid == false)
     {
-        db_reset();
+        dbSlot = DATABASE_SLOTS - 1;
+        db.sdb.sequence = 0;
+        db_defaults();
         return false;
     }
     
+    db_read(DATABASE_SLOT_LOC(dbSlot));
     return true;
 }
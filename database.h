@@ -2,20 +2,37 @@
 #define	DATABASE_H
 
 #include "EEPROM.h"
+#include "HCSR04.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
-#define DEFAULT_RANGE_POINT_1       5
-#define DEFAULT_RANGE_POINT_2       20
+// Range points are stored as echo times in microseconds
+#define DEFAULT_RANGE_POINT_1       HCSR04_CM(22)
+#define DEFAULT_RANGE_POINT_2       HCSR04_CM(88)
 
-#define DATABASE_MAX_SIZE   256
-#define DATABASE_LENGTH     6
-#define DATABASE_SEED       0xED2F
+// EEPROM used by the database. The rest holds the flight recorder snapshot.
+#define DATABASE_MAX_SIZE   192
+#define DATABASE_LENGTH     8
+// Initial CRC value. Changed whenever the stored units or layout change, so 
+// old databases are discarded.
+#define DATABASE_SEED       0xED31
 
-#define DATABASE_MEM_LOC_1  0
-#define DATABASE_MEM_LOC_2  (DATABASE_MAX_SIZE/2)
+// Record checksum. The CRC catches swapped bytes and the multi-bit errors 
+// the additive sum it replaced misses. The sum is only kept so tools/bench 
+// can compare what the two cost, as its records can't be read by the CRC.
+#define DATABASE_CHECKSUM_CRC16     0
+#define DATABASE_CHECKSUM_SUM       1
+
+#ifndef DATABASE_CHECKSUM
+#define DATABASE_CHECKSUM           DATABASE_CHECKSUM_CRC16
+#endif
+
+// The EEPROM is a ring of records. Each save goes in the slot after the 
+// newest one with the next sequence number, spreading wear over every slot.
+#define DATABASE_SLOTS          (DATABASE_MAX_SIZE / DATABASE_LENGTH)
+#define DATABASE_SLOT_LOC(slot) ((uint16_t) ((slot) * DATABASE_LENGTH))
 
 #define DATABASE_CHECKSUM_OFFSET   2
 
@@ -24,6 +41,7 @@ typedef union
     struct
     {
         uint16_t checksum;
+        uint16_t sequence;
         uint16_t rangePointRed;
         uint16_t rangePointYellow;
     } sdb;
@@ -35,7 +53,7 @@ extern database db;
 bool db_init(void);
 void db_reset(void);
 void db_save(void);
-uint16_t chcksum(uint8_t *array, size_t len, uint16_t seed);
+uint16_t crc16(uint8_t *array, size_t len, uint16_t seed);
 bool db_read(uint16_t location);
 void db_write(uint16_t location);
 
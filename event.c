@@ -0,0 +1,182 @@
+/*
+ * File:   event.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:47 AM
+ *
+ * Events posted by the ISR for the main loop. The main loop waits on them
+ * with the core in SLEEP whenever nothing needs the clock, and only wakes to
+ * handle one. CCP2 compares against TIMER1 to time waits that must stay
+ * awake, as the watchdog is the only timer running in SLEEP.
+ */
+
+#include "event.h"
+
+// Project includes
+#include "clock.h"
+#include "constants.h"
+#include "power.h"
+#include "profile.h"
+#include "TLC5926.h"
+#include "uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+// CCP2 compare mode raising CCP2IF only
+#define EVENT_COMPARE_SW_INT    0b1010
+
+volatile uint8_t eventsPending = 0;
+
+/*
+ * event_init
+ *
+ * Set up CCP2 to compare against TIMER1, which HCSR04_init() starts.
+ */
+void event_init(void)
+{
+    eventsPending = 0;
+
+    PIE2bits.CCP2IE = 0;
+    CCP2CONbits.CCP2M = EVENT_COMPARE_SW_INT;
+    PIR2bits.CCP2IF = 0;
+}
+
+/*
+ * event_timer_isr
+ *
+ * Post EVENT_TIMER when the CCP2 compare matches. Called from the ISR.
+ */
+void event_timer_isr(void)
+{
+    if (PIR2bits.CCP2IF && PIE2bits.CCP2IE)
+    {
+        PIE2bits.CCP2IE = 0;
+        event_post(EVENT_TIMER);
+    }
+    PIR2bits.CCP2IF = 0;
+}
+
+/*
+ * event_pending
+ *
+ * Output:
+ *      true if any of the events have been posted and not yet taken
+ */
+bool event_pending(uint8_t events)
+{
+    return (eventsPending & events) != 0;
+}
+
+/*
+ * event_take
+ *
+ * Take one event from the queue.
+ *
+ * Input:
+ *      event   EVENT_* to take, a single bit
+ *
+ * Output:
+ *      true if the event had been posted
+ */
+bool event_take(uint8_t event)
+{
+    if ((eventsPending & event) == 0)
+        return false;
+
+    // One bit, so this is a single BCF the ISR can't interrupt
+    eventsPending &= (uint8_t) ~event;
+    return true;
+}
+
+/*
+ * event_sleep
+ *
+ * Sleep until the next interrupt. Interrupts are held off from the check
+ * until SLEEP, so an event posted in between still wakes the core instead of
+ * being left for the watchdog. The ISR runs once they are back on. The UART
+ * stops in SLEEP, so the core stays awake while it is sending.
+ */
+void event_sleep(void)
+{
+    di();
+    if (eventsPending == 0 && UART_tx_idle() == true)
+    {
+        PROFILE_MARK_BEGIN(PROFILE_SLEEP);
+        SLEEP();
+        NOP();
+        PROFILE_MARK_END(PROFILE_SLEEP);
+    }
+    ei();
+}
+
+/*
+ * event_wait
+ *
+ * Wait until any of the events is posted or the time runs out, whichever is
+ * first. The core sleeps for the wait unless one of the events needs the
+ * clock, as TIMER1 times the echo and stops in SLEEP, or the LED's are being
+ * dimmed by PWM, which also stops in SLEEP. Then it busy waits at CLOCK_SLOW
+ * for the event or the CCP2 compare that times the wait.
+ *
+ * The events are left for the caller to take.
+ *
+ * Input:
+ *      events  EVENT_* to wait for, or 0 to just wait
+ *      ms      Longest time to wait in milliseconds
+ *
+ * Output:
+ *      The time waited in milliseconds
+ */
+uint16_t event_wait(uint8_t events, uint16_t ms)
+{
+    uint16_t waited = 0;
+    uint16_t start;
+    uint16_t compare;
+    uint16_t step;
+    uint8_t speed = clockSpeed;
+
+    while (waited < ms && event_pending(events) == false)
+    {
+        if ((events & EVENT_NEEDS_CLOCK) == 0 && TLC5926_IsDimmed() == false)
+        {
+            // Ends early only once one of the events is posted
+            waited += power_lowest(ms - waited, events);
+            continue;
+        }
+
+        step = ms - waited;
+        if (step > EVENT_TIMER_MAX_MS)
+            step = EVENT_TIMER_MAX_MS;
+
+        start = clock_timer1();
+        compare = start + step * 1000u;
+        CCPR2H = (uint8_t) (compare >> 8);
+        CCPR2L = (uint8_t) compare;
+        PIR2bits.CCP2IF = 0;
+        PIE2bits.CCP2IE = 1;
+
+        // Retried each time round in case the UART was still sending
+        PROFILE_MARK_BEGIN(PROFILE_WAIT);
+        while (event_pending(events | EVENT_TIMER) == false)
+        {
+            clock_set(CLOCK_SLOW);
+            CLRWDT();
+        }
+        PROFILE_MARK_END(PROFILE_WAIT);
+
+        clock_set(speed);
+        PIE2bits.CCP2IE = 0;
+        event_take(EVENT_TIMER);
+        step = (uint16_t) (clock_timer1() - start) / 1000;
+        power_account(step);
+        waited += step;
+    }
+
+    return waited;
+}
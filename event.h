@@ -0,0 +1,44 @@
+/*
+ * File:   event.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:47 AM
+ */
+
+#ifndef EVENT_H
+#define	EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Events posted by the ISR. Each is one bit, so posting and taking one can't
+// be torn by the other side.
+#define EVENT_ECHO          0x01    // Echo timed, or timed out
+#define EVENT_BUTTON_YELLOW 0x02    // Yellow button falling edge
+#define EVENT_BUTTON_RED    0x04    // Red button falling edge
+#define EVENT_ADC           0x08    // ADC conversion finished
+#define EVENT_TIMER         0x10    // event_wait() timer expired
+#define EVENT_NO_ECHO       0x20    // Sensor didn't start an echo
+
+#define EVENT_BUTTONS       (EVENT_BUTTON_YELLOW | EVENT_BUTTON_RED)
+
+// Events whose source stops in SLEEP. TIMER1 times the echo, so waiting for
+// one keeps the clock running.
+#define EVENT_NEEDS_CLOCK   (EVENT_ECHO | EVENT_NO_ECHO)
+
+// Longest time the CCP2 timer is armed for at once, within TIMER1's 65ms
+#define EVENT_TIMER_MAX_MS  50
+
+extern volatile uint8_t eventsPending;
+
+// Called from the ISR
+#define event_post(event)   (eventsPending |= (event))
+
+void event_init(void);
+void event_timer_isr(void);
+bool event_pending(uint8_t events);
+bool event_take(uint8_t event);
+void event_sleep(void);
+uint16_t event_wait(uint8_t events, uint16_t ms);
+
+#endif	/* EVENT_H */
@@ -10,13 +10,21 @@
 #include "config.h"
 #include "constants.h"
 #include "HCSR04.h"
+#include "battery.h"
+#include "clock.h"
 #include "TLC5926.h"
 #include "database.h"
+#include "event.h"
+#include "policy.h"
+#include "power.h"
+#include "profile.h"
+#include "recorder.h"
+#include "telemetry.h"
+#include "tracker.h"
 #include "uart.h"
 #include "utils.h"
 
 // C libraries
-#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -27,49 +35,33 @@
 #include <htc.h>
 #include <pic16f1828.h>
 
-#define MAX_COUNTER_VAL 100
-
-volatile bool btnYellowPressed = false;
-volatile bool btnRedPressed = false;
+#define MAX_COUNTER_VAL HCSR04_MAX_READING
 
 volatile bool timeCounterRunning = false;
-volatile uint8_t timeCounter = 0;
-volatile uint8_t timeReading = 0;
-volatile bool newTimeReading = false;
-
-#define BAUD_RATE_FAST  19200
+volatile uint16_t timeCounterStart = 0;
+volatile uint16_t timeReading = 0;
 
 void init(void) 
 {
-    OSCCONbits.SCS = 0b10;
-    OSCCONbits.IRCF = 0b1101;
+    clock_init();
     
     // Set the time-out period of the WDT
     WDTCON = WATCHDOG_TYP_512MS; // 512ms typical time-out period
 
     INTCONbits.GIE = 1; // Enable global interrupts
     INTCONbits.PEIE = 1; // Enable peripheral interrupts
-    INTCONbits.T0IE = 1; // Enable timer interrupts
     
     // Enable IOC
     INTCONbits.IOCIE = 1;
     
-    // Enable RA2 rising edge
-    IOCAPbits.IOCAP2 = 1;
-    // Enable RA2 falling edge
-    IOCANbits.IOCAN2 = 1;
-    
     // Enable RB5 and RB4 falling edge
     IOCBNbits.IOCBN4 = 1;
     IOCBNbits.IOCBN5 = 1;
-
-    // Enable each timer
-    INTCONbits.TMR0IE = 1;
     
     // Weak pull-up enabled on ECHO pin
     WPUAbits.WPUA2 = 1;
     
-    // Set timer0 prescaler to 1:1
+    // Enable weak pull-ups. Timer0 is no longer used for the echo.
     OPTION_REG = 0b00000000;
     
     TRISA = 0b11111111; // Inputs
@@ -80,100 +72,126 @@ void init(void)
     ANSELBbits.ANSB4 = 0;
     ANSELBbits.ANSB5 = 0;
     ANSELAbits.ANSELA = 0x00;
-    // Enable only RC1
-    ANSELCbits.ANSELC = 0x01;
+    ANSELCbits.ANSELC = 0x00;
     
-    // Configure the ADC for battery
-    ADCON1bits.ADCS = 0b000;            // F_osc/64. Slow as possible.
-    ADCON1bits.ADNREF = 0;              // V_ref- is connected to Vss
-    ADCON1bits.ADPREF = 0;              // V_ref+ is connected to Vdd
-    ADCON1bits.ADFM = 1;                // Right justify A/D result 
-    ADCON0bits.CHS = 0b00101;           // Enable AN5
-    ADCON0bits.ADON = 1;                // Turn on the ADC
+    // Configure the ADC for battery. This enables RC1 as analogue.
+    battery_init();
     
     // Set outputs to low initially
     PORTC = 0x00; 
     
+    // The sensor and LED's are powered by the states that use them
+    power_init();
+    
     // Initialise the database so that it is populated
+    PROFILE_MARK_BEGIN(PROFILE_DB_INIT);
     db_init(); 
+    PROFILE_MARK_END(PROFILE_DB_INIT);
     
-    // Enable RC5 to TLC
-    PIN_ENABLE_TLC5926 = 1;
-    
-    //UART_init(BAUD_RATE_FAST, _XTAL_FREQ, true, false);
-    TLC5926_init();
-    
-    // Drive it low to turn LED's on.
-    PIN_LED_OE = IO_LOW;
+    telemetry_init();
+    HCSR04_init();
     
-    // Enable RC0 to HCSR
-    PIN_ENABLE_HCSR04 = 1;
+    // The event timer compares against TIMER1
+    event_init();
     
-    __delay_ms(100);
-    
-    //UART_write_text("BOOT!\r\n");
+    // Profiling counts TIMER1 overflows, so it starts after the sensor
+    profile_init();
 }
 
-void save_reading()
+void save_reading(uint16_t reading)
 {
+    // Stop listening to the echo until the next trigger
+    PIE3bits.CCP3IE = 0;
+    PIE3bits.CCP4IE = 0;
+    
     // Set edge tracker low and save counter
     timeCounterRunning = false;
-    timeReading = timeCounter;
-    newTimeReading = true;
+    timeReading = reading;
+    event_post(EVENT_ECHO);
 }
 
 void interrupt ISR(void) 
 {
-    // Edge detected on echo pin
-    if (IOCAFbits.IOCAF2)
+    PROFILE_BEGIN(PROFILE_ISR);
+    
+    // Edge captured on echo pin
+    if (PIR3bits.CCP3IF && PIE3bits.CCP3IE)
     {
-
+        uint16_t capture = (uint16_t) ((CCPR3H << 8) | CCPR3L);
+        
         // If echo pin input is rising edge
-        if (PIN_US_ECHO == IO_HIGH && timeCounterRunning == false) {
-            // Set edge tracker high and reset counter
+        if (timeCounterRunning == false) {
+            // Set edge tracker high and save the start time
             timeCounterRunning = true;
-            timeCounter = 0;
+            timeCounterStart = capture;
+            
+            // Capture the falling edge next. The interrupt must be off while
+            // the mode changes to avoid a false capture.
+            PIE3bits.CCP3IE = 0;
+            CCP3CONbits.CCP3M = HCSR04_CAPTURE_FALLING;
+            PIR3bits.CCP3IF = 0;
+            PIE3bits.CCP3IE = 1;
+            
+            // Time out if the falling edge doesn't arrive
+            capture += MAX_COUNTER_VAL;
+            CCPR4H = (uint8_t) (capture >> 8);
+            CCPR4L = (uint8_t) capture;
+            PIR3bits.CCP4IF = 0;
+            PIE3bits.CCP4IE = 1;
         }
-        
         // If echo pin is falling edge
-        if (PIN_US_ECHO == IO_LOW && timeCounterRunning == true) {
-            save_reading();
+        else {
+            save_reading(capture - timeCounterStart);
         }
         
-        // Clear all individual IOC bits to continue
-        IOCAFbits.IOCAF2 = 0;
+        PIR3bits.CCP3IF = 0;
 	}
     
+    // Echo timed out, or never started
+    if (PIR3bits.CCP4IF && PIE3bits.CCP4IE) {
+        if (timeCounterRunning == true)
+            save_reading(HCSR04_NO_READING);
+        else {
+            PIE3bits.CCP3IE = 0;
+            PIE3bits.CCP4IE = 0;
+            event_post(EVENT_NO_ECHO);
+        }
+        
+        PIR3bits.CCP4IF = 0;
+    }
+    
     // Yellow button falling edge
     if (IOCBFbits.IOCBF4) {
-        btnYellowPressed = true;
+        event_post(EVENT_BUTTON_YELLOW);
         IOCBFbits.IOCBF4 = 0;
     }
     
     // Red button falling edge
     if (IOCBFbits.IOCBF5) {
-        btnRedPressed = true;
+        event_post(EVENT_BUTTON_RED);
         IOCBFbits.IOCBF5 = 0;
     }
     
-    // Timer 0
-    if (INTCONbits.TMR0IF && INTCONbits.TMR0IE) {
-        
-            // Increment counter if global echo bit is set
-            if (timeCounterRunning == true) {
-                timeCounter++;
-                // Handle overflow
-                if (timeCounter > MAX_COUNTER_VAL)
-                    save_reading();
-            }       
-
-        INTCONbits.TMR0IF = 0;
+    // ADC conversion finished
+    if (PIR1bits.ADIF && PIE1bits.ADIE) {
+        event_post(EVENT_ADC);
+        PIE1bits.ADIE = 0;
+        PIR1bits.ADIF = 0;
     }
+    
+    // Event timer expired
+    event_timer_isr();
+    
+    // UART ready for the next queued byte
+    if (PIR1bits.TXIF && PIE1bits.TXIE)
+        UART_tx_isr();
+    
+    // TIMER1 overflow, which extends the profiling timer
+    PROFILE_TIMER_ISR();
+    
+    PROFILE_END(PROFILE_ISR);
 }
 
-#define BUFSIZE 50
-#define FILTER_LEN 5
-
 // Application states
 #define APP_STATE_DISPLAY           0
 #define APP_STATE_STANDBY           1
@@ -182,17 +200,37 @@ void interrupt ISR(void)
 #define APP_STATE_ENTER_STANDBY     4
 #define APP_STATE_ENTER_CALIB       5
 #define APP_STATE_INDEFINITE_SLEEP  6
+#define APP_STATES                  7
+#define APP_STATE_NONE              0xFF
+
+// Events returned by the state handlers, or raised by the main loop, which
+// move the application between states through appTransitions
+#define APP_EVENT_NONE              0
+#define APP_EVENT_DONE              1   // Finished, move on
+#define APP_EVENT_FAILED            2   // Couldn't finish, start again
+#define APP_EVENT_IDLE              3   // Nothing happening, save power
+#define APP_EVENT_ACTIVITY          4   // Something is moving
+#define APP_EVENT_BUTTON            5   // Calibration button pressed
+#define APP_EVENT_NO_READING        6   // The sensor has stopped answering
+#define APP_EVENTS                  7
+
+// State flags
+#define APP_FLAG_READING            0x01    // Only runs with a new reading
+#define APP_FLAG_TRIGGER            0x02    // Triggers the sensor each pass
 
 // Calib types
 #define APP_CALIB_NONE              0
 #define APP_CALIB_YELLOW            1
 #define APP_CALIB_RED               2
 
+// Smallest distance from the median treated as a bad echo in the display state
+#define HAMPEL_MIN_THRESH           HCSR04_CM(10)
+
 // Threshold for changing between DISP_STATE_*
-#define DISP_THRESH_DIST            4
+#define DISP_THRESH_DIST            HCSR04_CM(18)
 
 // Threshold for differences between calibration points
-#define CALIB_DISTANCE              5
+#define CALIB_DISTANCE              HCSR04_CM(22)
 
 // Calibration Flashes
 #define CALIB_FLASHES               5
@@ -204,25 +242,25 @@ void interrupt ISR(void)
 #define DISP_STATE_YELLOW           3
 #define DISP_STATE_RED              4
 
-// Calculated using: 2.9V / 5V * 1024
-#define BATTERY_LOW_ENTER           580
-#define BATTERY_LOW_LEAVE           620
-
-#define BATTERY_NORMAL              0
-#define BATTERY_LOW                 1
-
-#define MAX_DELAY_UNTIL_READING_COUNT 3
-
+// Reading periods in ms. The display state picks one per reading depending 
+// on how fast the car is moving and how close it is to a range point.
 #define HCSR04_TRIG_DELAY_DISPLAY   200
+#define HCSR04_TRIG_DELAY_MOVING    100
+#define HCSR04_TRIG_DELAY_APPROACH  40
 #define HCSR04_TRIG_DELAY_STANDBY   0
 #define HCSR04_TRIG_DELAY_CAL       0
 
+// Change in echo time per 100ms above which the car is moving (~2cm/100ms)
+#define APPROACH_SPEED_MOVING       HCSR04_CM(2)
+// Distance from a range point inside which a moving car is sampled fastest
+#define APPROACH_NEAR_DIST          HCSR04_CM(50)
+
 // How different does the reading have to be from the standby reading to be valid
-#define STANDBY_COUNTER_THRESH      2
+#define STANDBY_COUNTER_THRESH      HCSR04_CM(9)
 // Number of valid readings before transitioning out of standby
 #define STANDBY_STABLE_READINGS     3
-// Number of stable readings to leave display state
-#define DISPLAY_STABLE_READINGS     25
+// Number of stable readings before the car is treated as stopped and dimmed
+#define DISPLAY_DIM_READINGS        5
 
 // The number of times the device is allowed to shift back and forth in display mode
 // before power saving is enabled
@@ -230,503 +268,682 @@ void interrupt ISR(void)
 
 #define MAX_NO_READING_THRESH       10
 
+// Blinks at full brightness, powering the LED's for it if the state doesn't
 void blink_light(uint16_t lightColour, uint8_t flashes) {
     uint8_t i = 0;
     
+    power_acquire(POWER_LEDS);
+    TLC5926_SetBrightness(TLC5926_BRIGHTNESS_FULL);
+    
     for (i = 0; i < flashes; i++) {
         TLC5926_SetLights(lightColour);
-        CLRWDT();
-        __delay_ms(200);
-        CLRWDT();
+        event_wait(0, 200);
         TLC5926_SetLights(LIGHT_OFF);
-        __delay_ms(200);
-        CLRWDT();
+        event_wait(0, 200);
     }
+    
+    power_release(POWER_LEDS);
 }
 
-// Delays in multiples of 10ms until a new reading has occurred
+// Waits until a new reading has occurred and at least minimumTime has passed,
+// sleeping for whatever is left once the echo has been timed. A button press
+// ends the wait early.
 uint16_t delay_until_reading(uint16_t minimumTime) 
 {
-#define DELAY_TIME  2
-#define MAX_COUNTS_UNTIL_ERR   50
-    unsigned char tBuf[20] = {0};
-    
-    int counter = 0;
-    for (counter = 0; 
-         !((newTimeReading == true) && 
-            (counter >= MAX_DELAY_UNTIL_READING_COUNT) &&
-            (counter >= (minimumTime/DELAY_TIME))
-           ) && (counter < MAX_COUNTS_UNTIL_ERR); 
-         counter++) 
-    {
-        CLRWDT();
-        __delay_ms(DELAY_TIME);
-//        sprintf(tBuf, "C %d %d %d %d\r\n", counter, timeReading, timeCounterRunning, newTimeReading);
-//        UART_write_text(tBuf);
-    }
+#define MIN_DELAY_TIME  6
+#define MAX_DELAY_TIME  100
+    uint16_t elapsed;
+    
+    if (minimumTime < MIN_DELAY_TIME)
+        minimumTime = MIN_DELAY_TIME;
+    
+    // TIMER1 stops in SLEEP, so this stays awake until the echo has been 
+    // timed, or the sensor has failed to start one
+    elapsed = event_wait(EVENT_ECHO | EVENT_NO_ECHO, MAX_DELAY_TIME);
     
-    return counter * DELAY_TIME;
+    // Sleep for the rest of the reading period
+    if (elapsed < minimumTime)
+        elapsed += event_wait(EVENT_BUTTONS, minimumTime - elapsed);
+    
+    return elapsed;
 }
 
-// Update the lights depending on the state.
+// Choose the next reading period for the display state. Readings are taken 
+// quickly while the car moves near a range point, and slowly while nothing is
+// changing.
+uint16_t nextReadingDelay(void)
+{
+    uint16_t speed;
+    uint16_t nearest;
+    uint16_t diff;
+    uint16_t position = tracker_position();
+    int16_t velocity = tracker_velocity();
+    
+    if (tracker_valid() == false)
+        return HCSR04_TRIG_DELAY_DISPLAY;
+    
+    // Change in echo time per 100ms
+    speed = (uint16_t) (velocity < 0 ? -velocity : velocity);
+    if (speed < APPROACH_SPEED_MOVING)
+        return HCSR04_TRIG_DELAY_DISPLAY;
+    
+    nearest = absdiff(position, db.sdb.rangePointRed);
+    diff = absdiff(position, db.sdb.rangePointYellow);
+    if (diff < nearest)
+        nearest = diff;
+    
+    if (nearest < APPROACH_NEAR_DIST)
+        return HCSR04_TRIG_DELAY_APPROACH;
+    else
+        return HCSR04_TRIG_DELAY_MOVING;
+}
+
+// Update the lights depending on the state, with only the LED's the power 
+// policy allows.
 void setLights(uint8_t displayState)
 {
     if (displayState == DISP_STATE_RED)
-        TLC5926_SetLights(LIGHT_RED);
+        TLC5926_SetLights(policy_lights(LIGHT_RED));
     else if (displayState == DISP_STATE_YELLOW)
-        TLC5926_SetLights(LIGHT_YELLOW);
+        TLC5926_SetLights(policy_lights(LIGHT_YELLOW));
     else if (displayState == DISP_STATE_GREEN)
-        TLC5926_SetLights(LIGHT_GREEN);
+        TLC5926_SetLights(policy_lights(LIGHT_GREEN));
     else if (displayState == DISP_STATE_OFF)
         TLC5926_SetLights(LIGHT_OFF);
 }
 
-void main()
+/*
+ * Application state machine. Each state has enter and exit handlers, run on
+ * a transition, and a run handler for each pass of the main loop. Whatever
+ * the states share between passes is kept here.
+ */
+typedef struct
+{
+    void (*enter)(void);
+    uint8_t (*run)(void);
+    void (*exit)(void);
+    uint8_t flags;
+    uint8_t power;      // POWER_* domains held while in the state
+} app_state;
+
+static uint8_t appState = APP_STATE_ENTER_DISPLAY;
+static uint8_t appCalibType = APP_CALIB_NONE;
+
+// Reading for this pass of the main loop, and how many passes have gone
+// without one
+static bool lastReadingValid = false;
+static uint16_t lastReading = 0;
+static uint8_t noReadingCounter = 0;
+
+// Filtering readings for calibration, standby and the display
+static uint16_t readings[FILTER_LEN] = {0};
+static uint8_t cIndex = 0;
+static uint16_t filteredReading = 0;
+
+// Reading standby compares against, and how many in a row have differed
+static uint16_t standbyReading = 0;
+static uint8_t standbyReadingCounter = 0;
+
+// Display state
+static uint8_t displayState = DISP_STATE_INIT;
+static uint8_t stableReadingCount = 0;
+static uint8_t displayFilterCount = 0;
+
+// Whether the battery measurement has been used by the display state yet
+static bool analogueReadingValid = false;
+
+// Variables for preventing endless transitioning from stopping powersaving mode
+static uint8_t greenYellowTransitionCount = 0;
+static uint8_t yellowRedTransitionCount = 0;
+
+// Minimum delay time for taking reading, and how long the last one took
+static uint16_t readingDelayTime = HCSR04_TRIG_DELAY_DISPLAY;
+static uint16_t readingPeriod = 0;
+
+// Handler for states with nothing to do on entry or exit
+static void state_nothing(void)
+{
+}
+
+//////////////////////////////////
+// Entering the display state
+//////////////////////////////////
+static uint8_t enter_display_run(void)
 {
-    /* Initialise main variables */
-    char buf[BUFSIZE];
-    
-    // Handle readings within main loop
-    bool lastReadingValid = false;
-    uint8_t lastReading = 0;
-    uint8_t standbyReading = 0;
-    
-    // Handle filtering readings for calibration
-    uint8_t readings[FILTER_LEN] = {0};
-    uint8_t cIndex = 0;
-    uint8_t filteredReading = 0;
-    
-    // Application state
-    uint8_t appState = APP_STATE_DISPLAY;
-    uint8_t appCalibType = APP_CALIB_NONE;
+    // Re-enable LED's on TLC
+    TLC5926_SetBrightness(TLC5926_BRIGHTNESS_FULL);
+    // Set delay time
+    readingDelayTime = HCSR04_TRIG_DELAY_DISPLAY;
+    tracker_reset();
+    
+    // Restart the outlier filter
+    cIndex = 0;
+    displayFilterCount = 0;
+    
+    // Measure the battery
+    battery_measure();
+    analogueReadingValid = false;
+    
+    // Reset the transition counter
+    greenYellowTransitionCount = 0;
+    yellowRedTransitionCount = 0;
+    
+    setLights(displayState);
+    stableReadingCount = 0;
+    
+    return APP_EVENT_DONE;
+}
+
+//////////////////////////////////
+// The display state
+//////////////////////////////////
+static uint8_t display_run(void)
+{
+    uint8_t oldDisplayState = displayState;
+    uint8_t event = APP_EVENT_NONE;
+    
+    // Outlier filtered reading, and the reading used for changes towards 
+    // red, which may be the predicted one
+    uint16_t displayReading;
+    uint16_t approachReading;
+    uint16_t nextDelay;
+#if TRACKER_PREDICTION
+    uint16_t predictedReading;
+#endif
    
-    // Display state
-    uint8_t displayState = DISP_STATE_INIT;
-    uint8_t stableReadingCount = 0;
+    // Update the power policy from the last battery measurement
+    if (analogueReadingValid == false)
+    {
+        // Redraw the lights if the LED mask changed
+        if (policy_update(battery_percent()) == true)
+            setLights(displayState);
+        
+        recorder_log(RECORDER_BATTERY, battery_millivolts());
+        telemetry_battery(battery_millivolts(), battery_percent());
+        
+        analogueReadingValid = true;
+    }
+    
+    // Reject single bad echoes before they reach the display
+    readings[cIndex] = lastReading;
+    circular_increment_counter(&cIndex, FILTER_LEN);
+    if (displayFilterCount < FILTER_LEN)
+    {
+        displayFilterCount++;
+        displayReading = lastReading;
+    }
+    else
+        displayReading = hampel(readings, lastReading, HAMPEL_MIN_THRESH);
+    
+    // Track the car. Timeouts are left out of the estimate.
+    approachReading = displayReading;
+    if (displayReading <= MAX_COUNTER_VAL)
+        tracker_update(displayReading, readingPeriod);
+    
+    // Sample faster while the car is moving, scaled back as the battery 
+    // drains
+    nextDelay = policy_reading_delay(nextReadingDelay());
+    
+#if TRACKER_PREDICTION
+    // Change towards red early if the car will be past the point by the next
+    // reading
+    if (displayReading <= MAX_COUNTER_VAL)
+    {
+        predictedReading = tracker_predict(nextDelay);
+        if (predictedReading < approachReading)
+            approachReading = predictedReading;
+    }
+#endif
+    
+    // Handle initial state of scale
+    if (oldDisplayState == DISP_STATE_INIT) 
+    {
+        // Set the initial state to whatever the first reading is
+        if (displayReading > db.sdb.rangePointYellow)
+            displayState = DISP_STATE_GREEN;
+        else if (displayReading > db.sdb.rangePointRed)
+            displayState = DISP_STATE_YELLOW;
+        else
+            displayState = DISP_STATE_RED;
+    }
+    // If the display state is green
+    else if (oldDisplayState == DISP_STATE_GREEN) 
+    {
+        // If the counter is within the yellow threshold, transition
+        if (approachReading < db.sdb.rangePointYellow) 
+        {
+            displayState = DISP_STATE_YELLOW;
+            greenYellowTransitionCount++;
+            yellowRedTransitionCount = 0;
+        }
+    
+    } 
+    // If the state is yellow
+    else if (oldDisplayState == DISP_STATE_YELLOW) 
+    {
+        // If the state is within the red threshold, transition
+        if (approachReading < db.sdb.rangePointRed) 
+        {
+            displayState = DISP_STATE_RED;
+            yellowRedTransitionCount++;
+        }
+        // If the state is outside the green threshold, transition
+        else if (displayReading > (db.sdb.rangePointYellow + DISP_THRESH_DIST))
+        {
+            displayState = DISP_STATE_GREEN;                
+            greenYellowTransitionCount++;
+        }
+    } 
+    // If the state is red
+    else if (oldDisplayState == DISP_STATE_RED) 
+    {
+        // If the state is within the yellow threshold, transition
+        if (displayReading > (db.sdb.rangePointRed + DISP_THRESH_DIST))
+        {
+            displayState = DISP_STATE_YELLOW;
+            yellowRedTransitionCount++;
+            greenYellowTransitionCount = 0;
+        }
+    }
+    
+    // If the led state hasn't been changed
+    if (displayState == oldDisplayState)
+    {
+        stableReadingCount++;
+        
+        // If this has reached the threshold, move to powersaving
+        if (stableReadingCount >= policy_stable_readings())
+            event = APP_EVENT_IDLE;
+    }
+    else if (greenYellowTransitionCount > SHIFTING_THRESH || 
+            yellowRedTransitionCount > SHIFTING_THRESH)
+    {
+        event = APP_EVENT_IDLE;
+        greenYellowTransitionCount = 0;
+        yellowRedTransitionCount = 0;
+    }
+    else 
+    {
+        stableReadingCount = 0;
+        setLights(displayState);
+    }
+    
+    // Dim the LED's once the car has stopped, scaled back as the battery
+    // drains, and take the next reading when the prediction was made for
+    if (event == APP_EVENT_NONE)
+    {
+        TLC5926_SetBrightness(policy_brightness(
+                stableReadingCount >= DISPLAY_DIM_READINGS));
+        readingDelayTime = nextDelay;
+    }
+    
+    return event;
+}
+
+//////////////////////////////////
+// Entering the standby state
+//////////////////////////////////
+static void enter_standby_enter(void)
+{
+    // Reset the index
+    cIndex = 0;
+    
+    // Reading delay time
+    readingDelayTime = HCSR04_TRIG_DELAY_STANDBY;
+    
+    // Nothing is timing critical now, so report the profile and on-times
+    profile_dump();
+    power_dump();
+}
+
+static uint8_t enter_standby_run(void)
+{
+    // Update the circular buffer
+    readings[cIndex] = lastReading;
+    circular_increment_counter(&cIndex, FILTER_LEN);
+
+    // Wait until the filter is full
+    if (cIndex != 0)
+        return APP_EVENT_NONE;
+    
+    PROFILE_MARK_BEGIN(PROFILE_MEDIAN);
+    standbyReading = MEDIAN_N(FILTER_LEN)(readings);
+    PROFILE_MARK_END(PROFILE_MEDIAN);
+
+    // If the reading isn't valid
+    if (filteredReading > MAX_COUNTER_VAL)
+    {
+        recorder_log(RECORDER_ERROR, TELEMETRY_ERROR_STANDBY);
+        telemetry_error(TELEMETRY_ERROR_STANDBY);
+        blink_light(LIGHT_RED, CALIB_FLASHES);
+        return APP_EVENT_FAILED;
+    }
+    
+    // If the reading is valid, move to standby
+    return APP_EVENT_DONE;
+}
+
+//////////////////////////////////
+// The standby state
+//////////////////////////////////
+static void standby_enter(void)
+{
+    standbyReadingCounter = 0;
+    policy_standby_reset();
+}
+
+static uint8_t standby_run(void)
+{
+    // Check if absolute difference is greater than threshold and 
+    // increment the transition counter if it is, reset it otherwise 
+    // and sleep the application
+    if (lastReading > 0 && lastReading <= MAX_COUNTER_VAL)
+    {                   
+        // Was the reading significantly different from the standby reading?
+        if (absdiff(lastReading, standbyReading) >= STANDBY_COUNTER_THRESH)
+        {
+            standbyReadingCounter++;
+            
+            // Poll quickly again while anything is moving
+            policy_standby_reset();
+            
+            // If there have been enough valid readings, enter the display 
+            // state, otherwise check again straight away
+            if (standbyReadingCounter >= STANDBY_STABLE_READINGS)
+                return APP_EVENT_ACTIVITY;
+            return APP_EVENT_NONE;
+        }
+        
+        // If it wasn't reset the counter.
+        standbyReadingCounter = 0;
+    }
     
-    // Minimum delay time for taking reading
-    uint16_t readingDelayTime = HCSR04_TRIG_DELAY_DISPLAY;
+    // Nothing brought us out of sleep, so sleep, polling less often as the
+    // battery drains and the longer nothing happens
+    policy_standby_idle();
+    power_release(POWER_SENSOR);
+    power_lowest(policy_standby_ms(), EVENT_BUTTONS);
+    power_acquire(POWER_SENSOR);
     
-    // Get a new analogue reading
-    bool analogueReadingValid = false;
-    bool batteryFlash = true;
+    return APP_EVENT_NONE;
+}
+
+//////////////////////////////////
+// Entering the calibration state
+//////////////////////////////////
+static void enter_calib_enter(void)
+{
+    // Reset the cIndex to 0
+    cIndex = 0;
+    // Re-enable LED's on TLC
+    TLC5926_SetBrightness(TLC5926_BRIGHTNESS_FULL);
+    // Set delay time
+    readingDelayTime = HCSR04_TRIG_DELAY_CAL;
+}
+
+static uint8_t enter_calib_run(void)
+{
+    // Update the circular buffer
+    readings[cIndex] = lastReading;
+    circular_increment_counter(&cIndex, FILTER_LEN);
     
-    // Variables for preventing endless transitioning from stopping powersaving mode
-    uint8_t greenYellowTransitionCount = 0;
-    uint8_t yellowRedTransitionCount = 0;
+    // Wait until the filter is full
+    if (cIndex != 0)
+        return APP_EVENT_NONE;
     
-    // Count the number of reading not received
-    uint8_t noReadingCounter = 0;
+    PROFILE_MARK_BEGIN(PROFILE_MEDIAN);
+    filteredReading = MEDIAN_N(FILTER_LEN)(readings);
+    PROFILE_MARK_END(PROFILE_MEDIAN);
+    
+    // If the reading isn't valid
+    if (filteredReading > MAX_COUNTER_VAL)
+    {
+        telemetry_calibration(appCalibType, TELEMETRY_CAL_UNSTABLE, filteredReading);
+        blink_light(LIGHT_RED, CALIB_FLASHES);
+        return APP_EVENT_FAILED;
+    }
+    
+    // If the reading is valid, calibrate it!
+    return APP_EVENT_DONE;
+}
+
+//////////////////////////////////
+// The calibration state
+//////////////////////////////////
+static uint8_t calib_run(void)
+{
+    // If the red button was pressed.
+    if (appCalibType == APP_CALIB_RED) {
+        // Check if the distance is outside of the calib range from 
+        // yellow
+        if (absdiff(db.sdb.rangePointYellow, filteredReading) > CALIB_DISTANCE) {
+            db.sdb.rangePointRed = filteredReading;
+            telemetry_calibration(appCalibType, TELEMETRY_CAL_OK, filteredReading);
+            blink_light(LIGHT_GREEN, CALIB_FLASHES);
+        }
+        else {
+            telemetry_calibration(appCalibType, TELEMETRY_CAL_TOO_CLOSE, filteredReading);
+            blink_light(LIGHT_YELLOW, CALIB_FLASHES);
+        }
+    }
+    // If the yellow button was pressed.
+    if (appCalibType == APP_CALIB_YELLOW) {
+        // Check if the distance is outside of the calib range from 
+        // red
+        if (absdiff(db.sdb.rangePointRed, filteredReading) > CALIB_DISTANCE) {
+            db.sdb.rangePointYellow = filteredReading;
+            telemetry_calibration(appCalibType, TELEMETRY_CAL_OK, filteredReading);
+            blink_light(LIGHT_GREEN, CALIB_FLASHES);
+        }
+        else {
+            telemetry_calibration(appCalibType, TELEMETRY_CAL_TOO_CLOSE, filteredReading);
+            blink_light(LIGHT_YELLOW, CALIB_FLASHES);
+        }
+    }
+    db_save();
+    
+    return APP_EVENT_DONE;
+}
+
+//////////////////////////////////
+// Sleeping forever when HCSR04 readings stop. Only a button press or a 
+// reset gets out of it.
+//////////////////////////////////
+static void indefinite_sleep_enter(void)
+{
+    // Keep what led up to this
+    recorder_log(RECORDER_ERROR, TELEMETRY_ERROR_NO_READING);
+    recorder_save();
+    telemetry_error(TELEMETRY_ERROR_NO_READING);
+    blink_light(LIGHT_CENTERS, 10);
+    
+    // The sensor and LED's are already off, so stop listening for the echo
+    PIE3bits.CCP3IE = 0;
+    PIE3bits.CCP4IE = 0;
+    T1CONbits.TMR1ON = 0;
+}
+
+static uint8_t indefinite_sleep_run(void)
+{
+    power_lowest(POWER_FOREVER, EVENT_BUTTONS);
+    
+    return APP_EVENT_NONE;
+}
+
+static void indefinite_sleep_exit(void)
+{
+    // Give the sensor another chance. The next state powers it.
+    HCSR04_init();
+    noReadingCounter = 0;
+}
+
+// Handlers for each state, indexed by APP_STATE_*
+static const app_state appStates[APP_STATES] = {
+    // APP_STATE_DISPLAY
+    {state_nothing, display_run, state_nothing,
+            APP_FLAG_READING | APP_FLAG_TRIGGER, POWER_SENSOR | POWER_LEDS},
+    // APP_STATE_STANDBY
+    {standby_enter, standby_run, state_nothing,
+            APP_FLAG_READING | APP_FLAG_TRIGGER, POWER_SENSOR},
+    // APP_STATE_CALIB
+    {state_nothing, calib_run, state_nothing, APP_FLAG_TRIGGER,
+            POWER_SENSOR | POWER_LEDS},
+    // APP_STATE_ENTER_DISPLAY
+    {state_nothing, enter_display_run, state_nothing, APP_FLAG_TRIGGER,
+            POWER_SENSOR | POWER_LEDS},
+    // APP_STATE_ENTER_STANDBY
+    {enter_standby_enter, enter_standby_run, state_nothing,
+            APP_FLAG_READING | APP_FLAG_TRIGGER, POWER_SENSOR},
+    // APP_STATE_ENTER_CALIB
+    {enter_calib_enter, enter_calib_run, state_nothing,
+            APP_FLAG_READING | APP_FLAG_TRIGGER, POWER_SENSOR | POWER_LEDS},
+    // APP_STATE_INDEFINITE_SLEEP
+    {indefinite_sleep_enter, indefinite_sleep_run, indefinite_sleep_exit, 0, 0},
+};
+
+// Next state for each state and event, indexed by APP_STATE_* then 
+// APP_EVENT_*. APP_STATE_NONE ignores the event.
+#define N   APP_STATE_NONE
+static const uint8_t appTransitions[APP_STATES][APP_EVENTS] = {
+    // NONE DONE FAILED IDLE ACTIVITY BUTTON NO_READING
+    // APP_STATE_DISPLAY
+    {N, N, N, APP_STATE_ENTER_STANDBY, N, 
+            APP_STATE_ENTER_CALIB, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_STANDBY
+    {N, N, N, N, APP_STATE_ENTER_DISPLAY, 
+            APP_STATE_ENTER_CALIB, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_CALIB
+    {N, APP_STATE_ENTER_DISPLAY, N, N, N, 
+            APP_STATE_ENTER_CALIB, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_ENTER_DISPLAY
+    {N, APP_STATE_DISPLAY, N, N, N, 
+            APP_STATE_ENTER_CALIB, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_ENTER_STANDBY
+    {N, APP_STATE_STANDBY, APP_STATE_ENTER_DISPLAY, N, N, 
+            APP_STATE_ENTER_CALIB, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_ENTER_CALIB
+    {N, APP_STATE_CALIB, APP_STATE_ENTER_DISPLAY, N, N, 
+            N, APP_STATE_INDEFINITE_SLEEP},
+    // APP_STATE_INDEFINITE_SLEEP
+    {N, N, N, N, N, APP_STATE_ENTER_CALIB, N},
+};
+#undef N
+
+// Move to the state the transition table gives for an event, if any, and
+// report it. Power domains only the old state used go off before the new 
+// state's come on.
+static void app_event(uint8_t event)
+{
+    uint8_t next = appTransitions[appState][event];
+    uint8_t power = appStates[appState].power;
+    
+    if (next == APP_STATE_NONE)
+        return;
+    
+    appStates[appState].exit();
+    appState = next;
+    
+    power_release(power & (uint8_t) ~appStates[appState].power);
+    power_acquire(appStates[appState].power & (uint8_t) ~power);
+    
+    recorder_log(RECORDER_STATE, appState);
+    telemetry_state(appState);
+    
+    appStates[appState].enter();
+}
+
+void main()
+{
+    uint8_t runState;
     
     /* Run init code*/
+    // Find out why we reset before anything else touches STATUS
+    recorder_init();
     init();
     
+    // Send the log from before a reset, and keep a copy in EEPROM if the 
+    // reset was unexpected. Holding the yellow button at power up sends the
+    // copy.
+    if (recorder_restored() == true)
+    {
+        recorder_dump();
+        if (recorder_reset_cause() & RECORDER_RESET_ABNORMAL)
+            recorder_save();
+    }
+    if (BTN_SET_YELLOW == 0)
+        recorder_dump_saved();
+    
     // Temporary code for testing
-    db.sdb.rangePointYellow = 15;
-    db.sdb.rangePointRed = 5;       
+    db.sdb.rangePointYellow = HCSR04_CM(66);
+    db.sdb.rangePointRed = HCSR04_CM(22);
     
-    /* Trigger the sensor for the first time */
+    /* Start by entering the display state, which measures the battery */
+    power_acquire(appStates[appState].power);
     TLC5926_SetLights(LIGHT_OFF);
+    appStates[appState].enter();
     HCSR04_Trigger();
     
     while(1) {
+        // Process at full speed so the core is back to waiting sooner
+        clock_set(CLOCK_FAST);
+        PROFILE_BEGIN(PROFILE_MAIN_LOOP);
         
-        // If there's been a new reading, add it to the circular buffer
-        if (newTimeReading == true) {
+        // If there's been a new reading, keep it for this pass
+        if (event_take(EVENT_ECHO) == true) {
             // Bump the watchdog
             CLRWDT();
             
+            // Combine it with the other sensors' latest
             lastReadingValid = true;
-            lastReading = timeReading;
+            lastReading = HCSR04_Fuse(timeReading);
             
-            // Process the reading            
-			//sprintf(buf, "R: %d\r\n", lastReading);
-			//UART_write_text(buf);
+            // Process the reading
+            recorder_log(RECORDER_READING, lastReading);
+            telemetry_reading(lastReading);
             
-            // Clear the new time reading
-            newTimeReading = false;
             noReadingCounter = 0;
         } else {
+            event_take(EVENT_NO_ECHO);
+            HCSR04_Missed();
             noReadingCounter++;
         }
-        //////////////////////////////////
-        // Handle entering sleep forever if 
-		// HCSR04 readings do not occur
-        //////////////////////////////////
+        
+        // Sleep forever if HCSR04 readings do not occur
         if (noReadingCounter > MAX_NO_READING_THRESH) 
-        {
-			blink_light(LIGHT_CENTERS, 10);
-			appState = APP_STATE_INDEFINITE_SLEEP;
-        }
-		//////////////////////////////////
-        // Handle the recurring sleep state
-		// NOTE: Exiting this state requires a reset of the device
-        //////////////////////////////////
-		if (appState == APP_STATE_INDEFINITE_SLEEP) {
-			
-			// Ensure all peripherals are turned off
-            INTCONbits.TMR0IE = 0;
-			PIN_ENABLE_HCSR04 = 0;
-			PIN_LED_OE = IO_HIGH;
-			PIN_ENABLE_TLC5926 = 0;
-			
-			// Change the watchdog to max timer
-			WDTCON = WATCHDOG_MAX_256S; // 256s interval.
-			
-			// Enter Sleep state
-            SLEEP();
-		}
-        //////////////////////////////////
-        // Handle entering the calibration state
-        //////////////////////////////////
-        if ((appState != APP_STATE_ENTER_CALIB) && 
-                (btnRedPressed == true || btnYellowPressed == true))
+            app_event(APP_EVENT_NO_READING);
+        
+        // Calibrate when a button is pressed, unless the state doesn't take
+        // it yet, which leaves it pending
+        if (event_pending(EVENT_BUTTONS) == true &&
+                appTransitions[appState][APP_EVENT_BUTTON] != APP_STATE_NONE)
         {
             // Set the calib type to which button was pressed
-            if (btnRedPressed == true)
+            if (event_pending(EVENT_BUTTON_RED) == true)
                 appCalibType = APP_CALIB_RED;
-            else if (btnYellowPressed == true)
-                appCalibType = APP_CALIB_YELLOW;
-            
-            btnRedPressed = false;
-            btnYellowPressed = false;
-            
-            // Enter the calibration state
-            appState = APP_STATE_ENTER_CALIB;
-        }
-        //////////////////////////////////
-        // Handle entering the standby state
-        //////////////////////////////////
-        if (appState == APP_STATE_ENTER_STANDBY && lastReadingValid == true)
-        {
-            static bool standbyStarted = false;
-            
-            // If the standby isn't running, start standby
-            if (standbyStarted == false)
-            {
-                // Reset the index
-                cIndex = 0;
-                // Disable LED's on TLC
-                PIN_LED_OE = IO_HIGH;
-                // Disable TLC via PIN_TLC_ENABLE
-                PIN_ENABLE_TLC5926 = 0;
-                
-                // Disable ADC module
-                ADCON0bits.ADON = 0;
-                
-                // Reading delay time
-                readingDelayTime = HCSR04_TRIG_DELAY_STANDBY;
-                
-                standbyStarted = true;
-            } 
             else
-            {
-                // Update the circular buffer
-                readings[cIndex] = lastReading;
-                circular_increment_counter(&cIndex, FILTER_LEN);
-
-                // If we've filled the filter, go to the calibration state
-                if (cIndex == 0)
-                {                    
-                    standbyReading = fastMedian5(readings);
-                    standbyStarted = false;
-
-                    // If the reading isn't valid
-                    if (filteredReading > MAX_COUNTER_VAL)
-                    {
-                        //UART_write_text("STANDBY FAIL: VAL\r\n");
-                        blink_light(LIGHT_RED, CALIB_FLASHES);
-                        appState = APP_STATE_ENTER_DISPLAY;
-                    }
-                    // If the reading is valid, move to standby
-                    else
-                        appState = APP_STATE_STANDBY;
-                }
-            }
-
-        }
-        //////////////////////////////////
-        // Handle the standby state
-        //////////////////////////////////
-        else if (appState == APP_STATE_STANDBY && lastReadingValid == true)
-        {
-            static uint8_t standbyReadingCounter = 0;
-            bool resleep = true;
-            
-            // Check if absolute difference is greater than threshold and 
-            // increment the transition counter if it is, reset it otherwise 
-            // and sleep the application
-            if (lastReading > 0 && lastReading <= MAX_COUNTER_VAL)
-            {                   
-                // Was the reading significantly different from the standby reading?
-                if (absdiff(lastReading, standbyReading) >= STANDBY_COUNTER_THRESH)
-                {
-                    standbyReadingCounter++;
-                    resleep = false;
-                    
-                    // If there have been enough valid readings, enter the display state
-                    if (standbyReadingCounter >= STANDBY_STABLE_READINGS)
-                    {
-                        appState = APP_STATE_ENTER_DISPLAY;
-                    }
-                }
-                // If it wasn't reset the counter.
-                else
-                {
-                    standbyReadingCounter = 0;
-                }
-            }
-            
-            // If nothing brought us out of sleep, sleep.
-            if (appState == APP_STATE_STANDBY && resleep == true)
-            {
-                
-                // Enter sleep mode
-                PIN_ENABLE_HCSR04 = 0;
-                SLEEP();            
-                PIN_ENABLE_HCSR04 = 1;
-            }
-        }
-        //////////////////////////////////
-        // Handle entering the display state
-        //////////////////////////////////
-        else if (appState == APP_STATE_ENTER_DISPLAY)
-        {
-            // Enable TLC
-            PIN_ENABLE_TLC5926 = 1;
-            // Re-enable LED's on TLC
-            PIN_LED_OE = IO_LOW;
-            // Set delay time
-            readingDelayTime = HCSR04_TRIG_DELAY_DISPLAY;
-            
-            // Enable the ADC
-            ADCON0bits.ADON = 1;
-            
-            // Start the ADC for a low battery reading
-            ADCON0bits.GO_nDONE = 1;
-            analogueReadingValid = false;
-            
-            // Reset the transition counter
-            greenYellowTransitionCount = 0;
-            yellowRedTransitionCount = 0;
-            
-            // Reset the battery flash variable
-            batteryFlash = true;
-            
-            setLights(displayState);
-            stableReadingCount = 0;
-            appState = APP_STATE_DISPLAY;
-        }
-        //////////////////////////////////
-        // Handle the display state
-        //////////////////////////////////
-        else if (appState == APP_STATE_DISPLAY && lastReadingValid == true)
-        {
-            uint8_t oldDisplayState = displayState;
-            static uint8_t batteryState = BATTERY_NORMAL;
-           
-            // Get the ADC reading for low battery
-            if (ADCON0bits.GO_nDONE == 0 && analogueReadingValid == false)
-            {
-                uint16_t analog = (ADRESHbits.ADRESH << 8) | ADRESLbits.ADRESL;
-                PIR1bits.ADIF = 0;
-                
-                // If we're below the low battery enter threshold, then set the
-                // battery state.
-                if (batteryState == BATTERY_NORMAL && analog < BATTERY_LOW_ENTER)
-                    batteryState = BATTERY_LOW;
-                else if (batteryState == BATTERY_LOW && analog > BATTERY_LOW_LEAVE)
-                    batteryState = BATTERY_NORMAL;
-                
-                //sprintf(buf, "A: %u\r\n", analog);
-                //UART_write_text(buf);
-                
-                analogueReadingValid = true;
-            }
-            
-            // Handle initial state of scale
-            if (oldDisplayState == DISP_STATE_INIT) 
-            {
-                // Set the initial state to whatever the first reading is
-                if (lastReading > db.sdb.rangePointYellow)
-                    displayState = DISP_STATE_GREEN;
-                else if (lastReading > db.sdb.rangePointRed)
-                    displayState = DISP_STATE_YELLOW;
-                else
-                    displayState = DISP_STATE_RED;
-            }
-            // If the display state is green
-            else if (oldDisplayState == DISP_STATE_GREEN) 
-            {
-                // If the counter is within the yellow threshold, transition
-                if (lastReading < db.sdb.rangePointYellow) 
-                {
-                    displayState = DISP_STATE_YELLOW;
-                    greenYellowTransitionCount++;
-                    yellowRedTransitionCount = 0;
-                }
-            
-            } 
-            // If the state is yellow
-            else if (oldDisplayState == DISP_STATE_YELLOW) 
-            {
-                // If the state is within the red threshold, transition
-                if (lastReading < db.sdb.rangePointRed) 
-                {
-                    displayState = DISP_STATE_RED;
-                    yellowRedTransitionCount++;
-                }
-                // If the state is outside the green threshold, transition
-                else if (lastReading > (db.sdb.rangePointYellow + DISP_THRESH_DIST))
-                {
-                    displayState = DISP_STATE_GREEN;                
-                    greenYellowTransitionCount++;
-                }
-            } 
-            // If the state is red
-            else if (oldDisplayState == DISP_STATE_RED) 
-            {
-                // If the state is within the yellow threshold, transition
-                if (lastReading > (db.sdb.rangePointRed + DISP_THRESH_DIST))
-                {
-                    displayState = DISP_STATE_YELLOW;
-                    yellowRedTransitionCount++;
-                    greenYellowTransitionCount = 0;
-                }
-            }
+                appCalibType = APP_CALIB_YELLOW;
             
-            // If the led state hasn't been changed
-            if (displayState == oldDisplayState)
-            {
-                stableReadingCount++;
-                
-                // If this has reached the threshold, move to powersaving
-                if (stableReadingCount == DISPLAY_STABLE_READINGS)
-                {
-                    appState = APP_STATE_ENTER_STANDBY;
-                }
-                // else if the battery is low
-                else if (batteryState == BATTERY_LOW)
-                {
-                    batteryFlash = !batteryFlash;
-                    if (batteryFlash == true)
-                        setLights(displayState);
-                    else
-                        setLights(DISP_STATE_OFF);
-                }
-
-
-            }
-            else if (greenYellowTransitionCount > SHIFTING_THRESH || 
-                    yellowRedTransitionCount > SHIFTING_THRESH)
-            {
-                appState = APP_STATE_ENTER_STANDBY;
-                greenYellowTransitionCount = 0;
-                yellowRedTransitionCount = 0;
-            }
-            else 
-            {
-                stableReadingCount = 0;
-                setLights(displayState);
-                batteryFlash = true;
-            }
-        }
-        //////////////////////////////////
-        // Handle entering the calibration state
-        //////////////////////////////////
-        else if (appState == APP_STATE_ENTER_CALIB && lastReadingValid == true)
-        {
-            static bool calibrationRunning = false;
+            event_take(EVENT_BUTTON_RED);
+            event_take(EVENT_BUTTON_YELLOW);
             
-            // If the calibration isn't running, start
-            if (calibrationRunning == false)
-            {
-                // Reset the cIndex to 0
-                cIndex = 0;
-                // Enable TLC
-                PIN_ENABLE_TLC5926 = 1;
-                // Re-enable LED's on TLC
-                PIN_LED_OE = IO_LOW;
-                // Set delay time
-                readingDelayTime = HCSR04_TRIG_DELAY_CAL;
-                
-                calibrationRunning = true;
-            }
-            // If the calibration is running
-            else
-            {
-                // Update the circular buffer
-                readings[cIndex] = lastReading;
-                circular_increment_counter(&cIndex, FILTER_LEN);
-                
-                // If we've filled the filter, go to the calibration state
-                if (cIndex == 0)
-                {
-                    filteredReading = fastMedian5(readings);
-                    calibrationRunning = false;
-                    // If the reading isn't valid
-                    if (filteredReading > MAX_COUNTER_VAL)
-                    {
-                        //UART_write_text("CAL FAIL: VAL\r\n");
-                        blink_light(LIGHT_RED, CALIB_FLASHES);
-                        appState = APP_STATE_ENTER_DISPLAY;
-                    }
-                    // If the reading is valid, calibrate it!
-                    else
-                        appState = APP_STATE_CALIB;
-                }
-            }
+            app_event(APP_EVENT_BUTTON);
         }
-        //////////////////////////////////
-        // Handle the calibration state
-        //////////////////////////////////
-        else if (appState == APP_STATE_CALIB)
-        {
-            // If the red button was pressed.
-            if (appCalibType == APP_CALIB_RED) {
-                // Check if the distance is outside of the calib range from 
-                // yellow
-                if (absdiff(db.sdb.rangePointYellow, filteredReading) > CALIB_DISTANCE) {
-                    db.sdb.rangePointRed = filteredReading;
-                    //sprintf(buf, "P RED: %d\r\n", db.sdb.rangePointRed);
-                    //UART_write_text(buf);
-                    blink_light(LIGHT_GREEN, CALIB_FLASHES);
-                }
-                else {
-                    //sprintf(buf, "PF RED: %d %d\r\n", db.sdb.rangePointYellow, filteredReading);
-                    //UART_write_text(buf);
-                    blink_light(LIGHT_YELLOW, CALIB_FLASHES);
-                }
-            }
-            // If the yellow button was pressed.
-            if (appCalibType == APP_CALIB_YELLOW) {
-                // Check if the distance is outside of the calib range from 
-                // red
-                if (absdiff(db.sdb.rangePointRed, filteredReading) > CALIB_DISTANCE) {
-                    db.sdb.rangePointYellow = filteredReading;
-                    //sprintf(buf, "P YEL: %d\r\n", db.sdb.rangePointYellow);
-                    //UART_write_text(buf);
-                    blink_light(LIGHT_GREEN, CALIB_FLASHES);
-                }
-                else {
-                    //sprintf(buf, "PF YEL: %d %d\r\n", db.sdb.rangePointRed, filteredReading);
-                    //UART_write_text(buf);
-                    blink_light(LIGHT_YELLOW, CALIB_FLASHES);
-                }
-            }
-            db_save();
-            appState = APP_STATE_ENTER_DISPLAY; 
+        
+        // Run the current state, which may wait for a reading
+        runState = appState;
+        if ((appStates[runState].flags & APP_FLAG_READING) == 0 || 
+                lastReadingValid == true)
+            app_event(appStates[runState].run());
+        
+        // We're done with the reading for this iteration of the application,
+        // so set the reading as invalid.
+        lastReadingValid = false;
+        
+        if (appStates[appState].flags & APP_FLAG_TRIGGER) {
+            HCSR04_Trigger();
+            readingPeriod = delay_until_reading(readingDelayTime);
         }
         
-		if (appState != APP_STATE_INDEFINITE_SLEEP) {
-			// We're done with the reading for this iteration of the application,
-			// so set the reading as invalid.
-			lastReadingValid = false;
-
-			HCSR04_Trigger();
-            delay_until_reading(readingDelayTime);
-			//sprintf(buf, "D: \r\n", );
-			//UART_write_text(buf);
-		}
+        PROFILE_END_STATE(runState);
     }
 }
@@ -0,0 +1,189 @@
+/*
+ * File:   policy.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:28 AM
+ *
+ * Battery-aware power policy. As the battery drains the display uses fewer
+ * and dimmer LED's, readings are taken less often, the display gives up
+ * sooner and standby polls more slowly. Standby also backs off on its own
+ * while nothing is happening.
+ */
+
+#include "policy.h"
+
+// Project includes
+#include "constants.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t minPercent;         // Lowest battery percentage for this level
+    uint16_t lights;            // Mask for the colour bitmaps
+    uint8_t brightness;         // Brightness while the car is moving
+    uint8_t stoppedBrightness;  // Brightness once the car has stopped
+    uint8_t delayMultiplier;    // Applied to the display reading period
+    uint8_t stableReadings;     // Stable readings before going to standby
+    uint8_t standbyPeriod;      // Standby watchdog period, 2^n ms
+} policy_settings;
+
+// Indexed by POLICY_LEVEL_*. stableReadings must stay above
+// DISPLAY_DIM_READINGS so the display still dims before it switches off.
+static const policy_settings settings[] = {
+    {50, POLICY_LEDS_ALL,       255, 64, 1, 25, 9},     // 512ms
+    {25, POLICY_LEDS_ALTERNATE, 128, 32, 2, 15, 10},    // 1s
+    {10, POLICY_LEDS_ALTERNATE, 64,  24, 3, 10, 11},    // 2s
+    {0,  LIGHT_CENTERS,         48,  16, 4, 6,  12},    // 4s
+};
+
+#define POLICY_LEVELS (sizeof(settings) / sizeof(settings[0]))
+
+static uint8_t level = POLICY_LEVEL_NORMAL;
+
+// Standby back-off, in doublings of the level's period, and the unchanged
+// readings seen at the current period
+static uint8_t backoff = 0;
+static uint8_t idleReadings = 0;
+
+/*
+ * policy_update
+ *
+ * Choose the power level for the remaining battery capacity. Moving to a
+ * lower level happens as soon as the capacity drops below it, but moving
+ * back up needs POLICY_HYSTERESIS_PERCENT more so the level doesn't
+ * bounce as the battery recovers under a lighter load.
+ *
+ * Input:
+ *      percent     Remaining capacity from battery_percent()
+ *
+ * Output:
+ *      true if the level changed
+ */
+bool policy_update(uint8_t percent)
+{
+    uint8_t oldLevel = level;
+
+    while (level < POLICY_LEVELS - 1 && percent < settings[level].minPercent)
+        level++;
+
+    while (level > POLICY_LEVEL_NORMAL &&
+            percent >= settings[level - 1].minPercent + POLICY_HYSTERESIS_PERCENT)
+        level--;
+
+    return level != oldLevel;
+}
+
+/*
+ * policy_level
+ *
+ * Output:
+ *      The current POLICY_LEVEL_*
+ */
+uint8_t policy_level(void)
+{
+    return level;
+}
+
+/*
+ * policy_lights
+ *
+ * Input:
+ *      bitmap      Colour bitmap to show
+ *
+ * Output:
+ *      The bitmap with the LED's unused at this level removed
+ */
+uint16_t policy_lights(uint16_t bitmap)
+{
+    return bitmap & settings[level].lights;
+}
+
+/*
+ * policy_reading_delay
+ *
+ * Input:
+ *      delay       Display reading period in ms
+ *
+ * Output:
+ *      The reading period stretched for this level
+ */
+uint16_t policy_reading_delay(uint16_t delay)
+{
+    return delay * settings[level].delayMultiplier;
+}
+
+/*
+ * policy_stable_readings
+ *
+ * Output:
+ *      Number of stable readings before the display state gives up
+ */
+uint8_t policy_stable_readings(void)
+{
+    return settings[level].stableReadings;
+}
+
+/*
+ * policy_brightness
+ *
+ * Input:
+ *      stopped     Whether the car has stopped moving
+ *
+ * Output:
+ *      LED brightness out of 255
+ */
+uint8_t policy_brightness(bool stopped)
+{
+    return stopped ? settings[level].stoppedBrightness : settings[level].brightness;
+}
+
+/*
+ * policy_standby_reset
+ *
+ * Go back to polling at the level's standby period. Called on entering
+ * standby and whenever a reading shows activity.
+ */
+void policy_standby_reset(void)
+{
+    backoff = 0;
+    idleReadings = 0;
+}
+
+/*
+ * policy_standby_idle
+ *
+ * Count an unchanged standby reading, and double the polling period after
+ * POLICY_BACKOFF_READINGS of them until it reaches POLICY_STANDBY_MAX_PS.
+ */
+void policy_standby_idle(void)
+{
+    if (settings[level].standbyPeriod + backoff >= POLICY_STANDBY_MAX_PS)
+        return;
+
+    idleReadings++;
+    if (idleReadings >= POLICY_BACKOFF_READINGS)
+    {
+        backoff++;
+        idleReadings = 0;
+    }
+}
+
+/*
+ * policy_standby_ms
+ *
+ * Output:
+ *      Standby polling period at this level in milliseconds, backed off for
+ *      a quiet spell and capped at 2^POLICY_STANDBY_MAX_PS
+ */
+uint16_t policy_standby_ms(void)
+{
+    uint8_t ps = settings[level].standbyPeriod + backoff;
+
+    if (ps > POLICY_STANDBY_MAX_PS)
+        ps = POLICY_STANDBY_MAX_PS;
+
+    return (uint16_t) 1 << ps;
+}
@@ -0,0 +1,60 @@
+/*
+ * File:   policy.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:28 AM
+ */
+
+#ifndef POLICY_H
+#define	POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Power levels, from a full battery down to a nearly flat one
+#define POLICY_LEVEL_NORMAL     0
+#define POLICY_LEVEL_SAVER      1
+#define POLICY_LEVEL_LOW        2
+#define POLICY_LEVEL_CRITICAL   3
+
+// Extra charge needed before moving back up a level
+#define POLICY_HYSTERESIS_PERCENT 5
+
+// LED masks applied to the colour bitmaps, before LIGHT_MAP places them on
+// the driver outputs. ALTERNATE keeps the first, middle and last of the 5 
+// LED's in each colour.
+#define POLICY_LEDS_ALL         0xFFFF
+#define POLICY_ALTERNATE(first) (LIGHT_LED(first) | LIGHT_LED((first) + 2) | \
+                                    LIGHT_LED((first) + 4))
+#define POLICY_LEDS_ALTERNATE   (POLICY_ALTERNATE(0) | POLICY_ALTERNATE(5) | \
+                                    POLICY_ALTERNATE(10))
+
+// Standby doubles its polling period after this many unchanged readings in a
+// row, starting from the period for the power level
+#ifndef POLICY_BACKOFF_READINGS
+#define POLICY_BACKOFF_READINGS 8
+#endif
+
+// Longest standby polling period, 2^n ms. This bounds how long a car can go
+// unnoticed after a quiet spell, so keep it well under the time it takes to
+// drive in. Past POWER_MAX_SLEEP_PS the wait is made of several sleeps, and
+// past 15 it no longer fits the 16 bit milliseconds power_lowest() takes.
+#ifndef POLICY_STANDBY_MAX_PS
+#define POLICY_STANDBY_MAX_PS   12      // 4s
+#endif
+
+#if POLICY_STANDBY_MAX_PS > 15
+#error "POLICY_STANDBY_MAX_PS must be 15 (32s) or less"
+#endif
+
+bool policy_update(uint8_t percent);
+uint8_t policy_level(void);
+uint16_t policy_lights(uint16_t bitmap);
+uint16_t policy_reading_delay(uint16_t delay);
+uint8_t policy_stable_readings(void);
+uint8_t policy_brightness(bool stopped);
+void policy_standby_reset(void);
+void policy_standby_idle(void);
+uint16_t policy_standby_ms(void);
+
+#endif	/* POLICY_H */
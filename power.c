@@ -0,0 +1,314 @@
+/* 
+ * File:   power.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:21 AM
+ *
+ * Power domains and the lowest power mode. Each domain is switched on when
+ * its first user acquires it and off when its last user releases it, always
+ * in the same order and with time to settle. Time passed in waits is added
+ * to every domain that is on, so wasted on-time shows up in telemetry.
+ */
+
+#include "power.h"
+
+// Project includes
+#include "clock.h"
+#include "constants.h"
+#include "event.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "TLC5926.h"
+#include "uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+// Users of each domain, and milliseconds each has been on, indexed by bit.
+// The last entry of onMs is the time accounted in total.
+static uint8_t users[POWER_DOMAINS];
+static uint32_t onMs[POWER_DOMAINS + 1];
+static uint8_t poweredDomains = 0;
+
+/*
+ * power_settle
+ * 
+ * Wait for a domain that has just been switched on, asleep if nothing else
+ * needs the clock.
+ */
+static void power_settle(uint16_t ms)
+{
+    power_lowest(ms, 0);
+}
+
+/*
+ * power_on
+ * 
+ * Switch one domain on. Its outputs are left off for the caller to set.
+ */
+static void power_on(uint8_t domain)
+{
+    switch (domain)
+    {
+        case POWER_SENSOR:
+            PIN_ENABLE_HCSR04 = 1;
+            power_settle(POWER_SETTLE_SENSOR_MS);
+            break;
+        case POWER_LEDS:
+            PIN_ENABLE_TLC5926 = 1;
+            power_settle(POWER_SETTLE_LEDS_MS);
+            TLC5926_init();
+            break;
+        case POWER_ADC:
+            FVRCONbits.FVREN = 1;
+            ADCON0bits.ADON = 1;
+            while (FVRCONbits.FVRRDY == 0)
+                ;
+            break;
+    }
+}
+
+/*
+ * power_off
+ * 
+ * Switch one domain off. The LED outputs are disabled and the data lines 
+ * driven low before the supply goes, so they don't back-power the driver.
+ */
+static void power_off(uint8_t domain)
+{
+    switch (domain)
+    {
+        case POWER_SENSOR:
+            PIN_ENABLE_HCSR04 = 0;
+            break;
+        case POWER_LEDS:
+            TLC5926_SetBrightness(TLC5926_BRIGHTNESS_OFF);
+            TLC5926_Shutdown();
+            PIN_ENABLE_TLC5926 = 0;
+            break;
+        case POWER_ADC:
+            ADCON0bits.ADON = 0;
+            FVRCONbits.FVREN = 0;
+            break;
+    }
+}
+
+/*
+ * power_init
+ * 
+ * Start with every domain off and nothing accounted.
+ */
+void power_init(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < POWER_DOMAINS; i++)
+    {
+        users[i] = 0;
+        power_off((uint8_t) (1 << i));
+    }
+    for (i = 0; i <= POWER_DOMAINS; i++)
+        onMs[i] = 0;
+    
+    poweredDomains = 0;
+}
+
+/*
+ * power_acquire
+ * 
+ * Add a user to each of the domains, switching on any that were off. Returns
+ * once they have settled.
+ * 
+ * Input:
+ *      domains     POWER_* bits
+ */
+void power_acquire(uint8_t domains)
+{
+    uint8_t i;
+    uint8_t domain;
+    
+    for (i = 0; i < POWER_DOMAINS; i++)
+    {
+        domain = (uint8_t) (1 << i);
+        if ((domains & domain) == 0)
+            continue;
+        
+        if (users[i]++ == 0)
+        {
+            poweredDomains |= domain;
+            power_on(domain);
+        }
+    }
+}
+
+/*
+ * power_release
+ * 
+ * Remove a user from each of the domains, switching off any that have none
+ * left.
+ * 
+ * Input:
+ *      domains     POWER_* bits
+ */
+void power_release(uint8_t domains)
+{
+    uint8_t i;
+    uint8_t domain;
+    
+    for (i = 0; i < POWER_DOMAINS; i++)
+    {
+        domain = (uint8_t) (1 << i);
+        if ((domains & domain) == 0 || users[i] == 0)
+            continue;
+        
+        if (--users[i] == 0)
+        {
+            power_off(domain);
+            poweredDomains &= (uint8_t) ~domain;
+        }
+    }
+}
+
+/*
+ * power_account
+ * 
+ * Add time that has passed to every domain that is on.
+ * 
+ * Input:
+ *      ms      Milliseconds since the last call
+ */
+void power_account(uint16_t ms)
+{
+    uint8_t i;
+    
+    for (i = 0; i < POWER_DOMAINS; i++)
+    {
+        if (poweredDomains & (1 << i))
+            onMs[i] += ms;
+    }
+    onMs[POWER_DOMAINS] += ms;
+}
+
+/*
+ * power_lowest
+ * 
+ * Wait for the given time in the lowest power mode allowed. That is SLEEP, 
+ * with the watchdog as the wake-up timer, unless the LEDs are being dimmed 
+ * by PWM, which stops in SLEEP, when it is a busy loop at CLOCK_SLOW. The 
+ * wait is split into power of two watchdog periods, so it is only as 
+ * accurate as LFINTOSC. The wait ends early once one of the events is 
+ * posted. Any other interrupt (e.g. a button while power_settle() waits) 
+ * only cuts the period it came in short, and as nothing times that part it 
+ * is counted as half the period, at least 1ms. That is right on average, and every wake makes progress.
+ * 
+ * Interrupts are held off from checking the events until SLEEP, as in 
+ * event_sleep(), so one posted in between still wakes the core.
+ * 
+ * TIMER1, TIMER2 and the UART all stop in SLEEP. The caller must not be 
+ * timing an echo, and the UART queue is flushed first.
+ * 
+ * Input:
+ *      ms      Time to wait in milliseconds, or POWER_FOREVER to sleep until
+ *              an interrupt. The watchdog still wakes the core at its 
+ *              longest period then, and the time isn't accounted.
+ *      events  EVENT_* that end the wait, or 0 for none
+ * 
+ * Output:
+ *      The time waited in milliseconds
+ */
+uint16_t power_lowest(uint16_t ms, uint8_t events)
+{
+    uint8_t savedWdt = WDTCON;
+    uint8_t savedSpeed = clockSpeed;
+    uint16_t slept = 0;
+    uint8_t ps;
+    
+    if (ms == POWER_FOREVER)
+    {
+        UART_flush();
+        WDTCON = WATCHDOG_MAX_256S;
+        CLRWDT();
+        di();
+        if ((eventsPending & events) == 0)
+        {
+            PROFILE_MARK_BEGIN(PROFILE_SLEEP);
+            SLEEP();
+            NOP();
+            PROFILE_MARK_END(PROFILE_SLEEP);
+        }
+        ei();
+        WDTCON = savedWdt;
+        CLRWDT();
+        return 0;
+    }
+    
+    if (TLC5926_IsDimmed() == true)
+    {
+        clock_set(CLOCK_SLOW);
+        PROFILE_MARK_BEGIN(PROFILE_WAIT);
+        for (slept = 0; slept < ms && (eventsPending & events) == 0; slept++)
+        {
+            CLRWDT();
+            CLOCK_DELAY_US(1000);
+        }
+        PROFILE_MARK_END(PROFILE_WAIT);
+        clock_set(savedSpeed);
+        power_account(slept);
+        return slept;
+    }
+    
+    UART_flush();
+    
+    while (slept < ms)
+    {
+        // Largest period that fits in the remaining time
+        for (ps = 0; ps < POWER_MAX_SLEEP_PS && 
+                ((uint16_t) 2 << ps) <= (ms - slept); ps++)
+            ;
+        
+        WDTCON = WATCHDOG_PERIOD(ps);
+        CLRWDT();
+        di();
+        if ((eventsPending & events) != 0)
+        {
+            ei();
+            break;
+        }
+        PROFILE_MARK_BEGIN(PROFILE_SLEEP);
+        SLEEP();
+        NOP();
+        PROFILE_MARK_END(PROFILE_SLEEP);
+        ei();
+        
+        // If the watchdog didn't wake us, an interrupt did, part way through
+        if (STATUSbits.nTO == 1 && ps > 0)
+            slept += (uint16_t) 1 << (ps - 1);
+        else
+            slept += (uint16_t) 1 << ps;
+    }
+    
+    WDTCON = savedWdt;
+    CLRWDT();
+    
+    power_account(slept);
+    return slept;
+}
+
+/*
+ * power_dump
+ * 
+ * Send how long each domain has been on since reset, and the total time 
+ * accounted, as telemetry.
+ */
+void power_dump(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i <= POWER_DOMAINS; i++)
+        telemetry_power(i, onMs[i]);
+}
@@ -0,0 +1,39 @@
+/* 
+ * File:   power.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:21 AM
+ */
+
+#ifndef POWER_H
+#define	POWER_H
+
+#include <stdint.h>
+
+// Power domains. Each is one bit, so several can be acquired at once.
+#define POWER_SENSOR        0x01    // HC-SR04 supply, PIN_ENABLE_HCSR04
+#define POWER_LEDS          0x02    // TLC5926 supply, PIN_ENABLE_TLC5926
+#define POWER_ADC           0x04    // ADC and fixed voltage reference
+#define POWER_DOMAINS       3
+
+// Time to settle after a domain's supply is switched on, in milliseconds.
+// The HC-SR04 has no figure in its datasheet, but its MCU and the charge 
+// pump for the transmitter need a few ms before a trigger is answered. The
+// TLC5926 only needs its supply to have risen. The ADC waits for FVRRDY.
+#define POWER_SETTLE_SENSOR_MS  8
+#define POWER_SETTLE_LEDS_MS    1
+
+// Longest single watchdog period used while sleeping (2^12 = 4s)
+#define POWER_MAX_SLEEP_PS  12
+
+// power_lowest() time to sleep until an interrupt
+#define POWER_FOREVER       0xFFFF
+
+void power_init(void);
+void power_acquire(uint8_t domains);
+void power_release(uint8_t domains);
+void power_account(uint16_t ms);
+uint16_t power_lowest(uint16_t ms, uint8_t events);
+void power_dump(void);
+
+#endif	/* POWER_H */
@@ -0,0 +1,235 @@
+/*
+ * File:   profile.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:35 AM
+ *
+ * Region profiling against TIMER1. The clock manager keeps TIMER1 counting 
+ * microseconds at every clock speed, so every figure is in microseconds 
+ * whatever speed the region ran at. Overflows are counted to extend it to 32
+ * bits. TIMER1 stops in SLEEP, so only time spent awake is counted. Regions 
+ * include any interrupts taken while they run.
+ *
+ * The bench build only writes each marker to profileMark, and the simulator
+ * logs the writes against its cycle count.
+ */
+
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+// Project includes
+#include "constants.h"
+#include "telemetry.h"
+#include "uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+typedef struct
+{
+    uint32_t start;
+    uint32_t min;
+    uint32_t max;
+    uint32_t total;
+    uint16_t count;
+} profile_region;
+
+static profile_region regions[PROFILE_REGIONS];
+static uint32_t stateMax[PROFILE_STATES];
+static volatile uint16_t overflows = 0;
+
+// Microseconds taken by an empty region, removed from every measurement
+static uint32_t overhead = 0;
+
+/*
+ * profile_timer
+ *
+ * Read TIMER1 extended by the overflow count. An overflow that hasn't been
+ * counted yet, because we're in the ISR or it is about to run, is added in.
+ *
+ * Output:
+ *      Microseconds since TIMER1 was started
+ */
+static uint32_t profile_timer(void)
+{
+    uint16_t count;
+    uint8_t high;
+    uint8_t low;
+
+    do
+    {
+        count = overflows;
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H || count != overflows);
+
+    if (PIR1bits.TMR1IF == 1 && high < 0x80)
+        count++;
+
+    return ((uint32_t) count << 16) | ((uint16_t) high << 8) | low;
+}
+
+/*
+ * profile_timer_isr
+ *
+ * Count a TIMER1 overflow. Called from the ISR.
+ */
+void profile_timer_isr(void)
+{
+    if (PIR1bits.TMR1IF == 1 && PIE1bits.TMR1IE == 1)
+    {
+        overflows++;
+        PIR1bits.TMR1IF = 0;
+    }
+}
+
+/*
+ * profile_init
+ *
+ * Clear the statistics and measure the cost of the markers. TIMER1 must
+ * already be running.
+ */
+void profile_init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < PROFILE_REGIONS; i++)
+    {
+        regions[i].min = UINT32_MAX;
+        regions[i].max = 0;
+        regions[i].total = 0;
+        regions[i].count = 0;
+    }
+    for (i = 0; i < PROFILE_STATES; i++)
+        stateMax[i] = 0;
+
+#ifdef PROFILE_PIN_REGION
+    PROFILE_PIN = IO_LOW;
+    PROFILE_PIN_TRIS = 0;
+#endif
+
+    PIR1bits.TMR1IF = 0;
+    PIE1bits.TMR1IE = 1;
+
+    // An empty region, which is then forgotten
+    overhead = 0;
+    profile_begin(PROFILE_MAIN_LOOP);
+    profile_end(PROFILE_MAIN_LOOP);
+    overhead = regions[PROFILE_MAIN_LOOP].total;
+
+    regions[PROFILE_MAIN_LOOP].min = UINT32_MAX;
+    regions[PROFILE_MAIN_LOOP].max = 0;
+    regions[PROFILE_MAIN_LOOP].total = 0;
+    regions[PROFILE_MAIN_LOOP].count = 0;
+}
+
+/*
+ * profile_begin
+ *
+ * Start timing a region.
+ */
+void profile_begin(uint8_t region)
+{
+#ifdef PROFILE_PIN_REGION
+    if (region == PROFILE_PIN_REGION)
+        PROFILE_PIN = IO_HIGH;
+#endif
+
+    regions[region].start = profile_timer();
+}
+
+/*
+ * profile_end
+ *
+ * Stop timing a region and add it to the statistics.
+ *
+ * Output:
+ *      Microseconds the region took
+ */
+uint32_t profile_end(uint8_t region)
+{
+    profile_region *r = &regions[region];
+    uint32_t us = profile_timer() - r->start;
+
+    us = us > overhead ? us - overhead : 0;
+
+    if (us < r->min)
+        r->min = us;
+    if (us > r->max)
+        r->max = us;
+    r->total += us;
+    r->count++;
+
+#ifdef PROFILE_PIN_REGION
+    if (region == PROFILE_PIN_REGION)
+        PROFILE_PIN = IO_LOW;
+#endif
+
+    return us;
+}
+
+/*
+ * profile_state
+ *
+ * Keep the longest pass of the main loop for an application state.
+ */
+void profile_state(uint8_t state, uint32_t us)
+{
+    if (us > stateMax[state])
+        stateMax[state] = us;
+}
+
+/*
+ * profile_send
+ *
+ * Send one statistic as telemetry, waiting for room in the UART queue so
+ * none are dropped.
+ */
+static void profile_send(uint8_t region, uint8_t stat, uint32_t value)
+{
+    CLRWDT();
+    UART_flush();
+    telemetry_profile(region, stat, value);
+}
+
+/*
+ * profile_dump
+ *
+ * Send the count, minimum, maximum and total microseconds of every region 
+ * that has run over the UART, followed by the longest pass in each 
+ * application state.
+ */
+void profile_dump(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < PROFILE_REGIONS; i++)
+    {
+        if (regions[i].count == 0)
+            continue;
+
+        profile_send(i, PROFILE_STAT_COUNT, regions[i].count);
+        profile_send(i, PROFILE_STAT_MIN, regions[i].min);
+        profile_send(i, PROFILE_STAT_MAX, regions[i].max);
+        profile_send(i, PROFILE_STAT_TOTAL, regions[i].total);
+    }
+
+    for (i = 0; i < PROFILE_STATES; i++)
+    {
+        if (stateMax[i] != 0)
+            profile_send(PROFILE_STATE(i), PROFILE_STAT_MAX, stateMax[i]);
+    }
+}
+
+#elif PROFILE_BENCH
+
+// Written by every marker, and watched by tools/bench
+volatile uint8_t profileMark = 0;
+
+#endif
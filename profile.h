@@ -0,0 +1,105 @@
+/*
+ * File:   profile.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:35 AM
+ */
+
+#ifndef PROFILE_H
+#define	PROFILE_H
+
+#include <stdint.h>
+
+// Set to 1 to build in the profiling regions. When 0 the markers generate no
+// code at all.
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED     0
+#endif
+
+// Set to 1 instead to have every marker write its region to profileMark, for
+// tools/bench to time under a simulator. Nothing is kept or sent.
+#ifndef PROFILE_BENCH
+#define PROFILE_BENCH       0
+#endif
+
+#if PROFILE_ENABLED && PROFILE_BENCH
+#error "PROFILE_ENABLED and PROFILE_BENCH can't be built together"
+#endif
+
+// Profiled regions
+#define PROFILE_ISR         0
+#define PROFILE_SET_LIGHTS  1
+#define PROFILE_DB_SAVE     2
+#define PROFILE_MAIN_LOOP   3
+#define PROFILE_REGIONS     4
+
+// Passes of the main loop are also kept per application state, which only
+// keeps the longest. Mirrors APP_STATE_* in main.c.
+#define PROFILE_STATES      7
+#define PROFILE_STATE(state)    (PROFILE_REGIONS + (state))
+
+// Regions only marked for the bench, as they can't be timed by TIMER1 (it 
+// stops in SLEEP) or would cost RAM to keep
+#define PROFILE_MEDIAN      (PROFILE_STATE(PROFILE_STATES) + 0)
+#define PROFILE_DB_INIT     (PROFILE_STATE(PROFILE_STATES) + 1)
+#define PROFILE_WAIT        (PROFILE_STATE(PROFILE_STATES) + 2)
+#define PROFILE_SLEEP       (PROFILE_STATE(PROFILE_STATES) + 3)
+
+// Set in the region written to profileMark when the region ends
+#define PROFILE_MARK_END_BIT    0x80
+
+// Statistics sent for each region
+#define PROFILE_STAT_COUNT  0
+#define PROFILE_STAT_MIN    1
+#define PROFILE_STAT_MAX    2
+#define PROFILE_STAT_TOTAL  3
+
+// Region that drives the debug pin high while it runs, for a scope. Leave
+// undefined for no debug pin. RA5 is also the third sensor's trigger, so
+// HCSR04.c refuses to build both.
+//#define PROFILE_PIN_REGION  PROFILE_ISR
+#define PROFILE_PIN         LATAbits.LATA5
+#define PROFILE_PIN_TRIS    TRISAbits.TRISA5
+
+#if PROFILE_ENABLED
+void profile_init(void);
+void profile_timer_isr(void);
+void profile_begin(uint8_t region);
+uint32_t profile_end(uint8_t region);
+void profile_state(uint8_t state, uint32_t us);
+void profile_dump(void);
+
+#define PROFILE_BEGIN(region)   profile_begin(region)
+#define PROFILE_END(region)     profile_end(region)
+#define PROFILE_END_STATE(state)    profile_state(state, profile_end(PROFILE_MAIN_LOOP))
+#define PROFILE_TIMER_ISR()     profile_timer_isr()
+
+#define PROFILE_MARK_BEGIN(region)
+#define PROFILE_MARK_END(region)
+#elif PROFILE_BENCH
+extern volatile uint8_t profileMark;
+
+#define profile_init()          ((void) 0)
+#define profile_dump()          ((void) 0)
+
+#define PROFILE_BEGIN(region)   (profileMark = (region))
+#define PROFILE_END(region)     (profileMark = (uint8_t) ((region) | PROFILE_MARK_END_BIT))
+#define PROFILE_END_STATE(state)    PROFILE_END(PROFILE_STATE(state))
+#define PROFILE_TIMER_ISR()
+
+#define PROFILE_MARK_BEGIN(region)  PROFILE_BEGIN(region)
+#define PROFILE_MARK_END(region)    PROFILE_END(region)
+#else
+#define profile_init()          ((void) 0)
+#define profile_dump()          ((void) 0)
+
+#define PROFILE_BEGIN(region)
+#define PROFILE_END(region)
+#define PROFILE_END_STATE(state)
+#define PROFILE_TIMER_ISR()
+
+#define PROFILE_MARK_BEGIN(region)
+#define PROFILE_MARK_END(region)
+#endif
+
+#endif	/* PROFILE_H */
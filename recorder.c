@@ -0,0 +1,270 @@
+/*
+ * File:   recorder.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:33 AM
+ *
+ * Flight recorder. The last RECORDER_LEN events are kept in RAM that the
+ * startup code doesn't clear, so they survive a watchdog or MCLR reset and
+ * can be dumped over the UART on the next boot. A snapshot can also be kept
+ * in EEPROM, where it survives losing power.
+ */
+
+#include "recorder.h"
+
+#if RECORDER_ENABLED
+
+// Project includes
+#include "constants.h"
+#include "EEPROM.h"
+#include "database.h"
+#include "telemetry.h"
+#include "uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// PIC Includes
+#include <xc.h>
+#include <htc.h>
+
+#if RECORDER_EEPROM_LOC + RECORDER_EEPROM_LEN > 256
+#error "The flight recorder snapshot doesn't fit after the database"
+#endif
+
+#define RECORDER_MASK       (RECORDER_LEN - 1)
+// Marks the persistent RAM as holding a log, rather than power-on garbage
+#define RECORDER_MAGIC      0x5AC3
+
+// Types and values are kept in separate arrays so logging an event is only
+// two indexed stores
+static __persistent uint8_t recorderTypes[RECORDER_LEN];
+static __persistent uint16_t recorderValues[RECORDER_LEN];
+static __persistent uint8_t recorderHead;
+static __persistent uint8_t recorderCount;
+static __persistent uint16_t recorderMagic;
+
+static uint8_t resetCause = RECORDER_RESET_POWER_ON;
+static bool restored = false;
+
+/*
+ * recorder_decode_reset
+ *
+ * Work out why the device reset, then re-arm PCON for the next reset.
+ */
+static uint8_t recorder_decode_reset(void)
+{
+    uint8_t cause = 0;
+
+    if (PCONbits.nPOR == 0)
+        cause |= RECORDER_RESET_POWER_ON;
+    else if (PCONbits.nBOR == 0)
+        cause |= RECORDER_RESET_BROWN_OUT;
+    if (STATUSbits.nTO == 0)
+        cause |= RECORDER_RESET_WATCHDOG;
+    if (PCONbits.nRMCLR == 0)
+        cause |= RECORDER_RESET_MCLR;
+    if (PCONbits.nRI == 0)
+        cause |= RECORDER_RESET_INSTRUCTION;
+    if (PCONbits.STKOVF == 1 || PCONbits.STKUNF == 1)
+        cause |= RECORDER_RESET_STACK;
+
+    PCON = 0b00001111;
+
+    return cause;
+}
+
+/*
+ * recorder_init
+ *
+ * Call first in main(), before anything changes STATUS. The log is kept
+ * unless this was a power-on reset, and the reset is logged.
+ */
+void recorder_init(void)
+{
+    resetCause = recorder_decode_reset();
+
+    restored = (recorderMagic == RECORDER_MAGIC &&
+            (resetCause & RECORDER_RESET_POWER_ON) == 0 &&
+            recorderCount <= RECORDER_LEN);
+
+    if (restored == false)
+    {
+        recorderHead = 0;
+        recorderCount = 0;
+        recorderMagic = RECORDER_MAGIC;
+    }
+
+    recorder_log(RECORDER_RESET, resetCause);
+}
+
+/*
+ * recorder_log
+ *
+ * Add an event, overwriting the oldest once the log is full.
+ */
+void recorder_log(uint8_t type, uint16_t value)
+{
+    recorderTypes[recorderHead] = type;
+    recorderValues[recorderHead] = value;
+    recorderHead = (recorderHead + 1) & RECORDER_MASK;
+    if (recorderCount < RECORDER_LEN)
+        recorderCount++;
+}
+
+/*
+ * recorder_reset_cause
+ *
+ * Output:
+ *      RECORDER_RESET_* flags for the last reset
+ */
+uint8_t recorder_reset_cause(void)
+{
+    return resetCause;
+}
+
+/*
+ * recorder_restored
+ *
+ * Output:
+ *      true if the log from before the last reset was kept
+ */
+bool recorder_restored(void)
+{
+    return restored;
+}
+
+/*
+ * recorder_send
+ *
+ * Send one event as telemetry, waiting for room in the UART queue so none
+ * are dropped.
+ */
+static void recorder_send(uint8_t type, uint16_t value)
+{
+    CLRWDT();
+    UART_flush();
+    telemetry_event(type, value);
+}
+
+/*
+ * recorder_dump
+ *
+ * Send the log over the UART, oldest first.
+ */
+void recorder_dump(void)
+{
+    uint8_t i;
+    uint8_t index = (recorderHead - recorderCount) & RECORDER_MASK;
+
+    recorder_send(RECORDER_DUMP, RECORDER_DUMP_RAM);
+    for (i = 0; i < recorderCount; i++)
+    {
+        recorder_send(recorderTypes[index], recorderValues[index]);
+        index = (index + 1) & RECORDER_MASK;
+    }
+}
+
+/*
+ * recorder_snapshot_byte
+ *
+ * Serialise the log, oldest first, as the bytes stored in EEPROM.
+ *
+ * Input:
+ *      i       Offset into the snapshot
+ *
+ * Output:
+ *      Snapshot byte, excluding the CRC
+ */
+static uint8_t recorder_snapshot_byte(uint8_t i)
+{
+    uint8_t index;
+
+    if (i == 0)
+        return recorderCount;
+
+    i--;
+    index = (uint8_t) ((recorderHead - recorderCount + i / 3) & RECORDER_MASK);
+    if (i % 3 == 0)
+        return recorderTypes[index];
+    else if (i % 3 == 1)
+        return (uint8_t) recorderValues[index];
+    else
+        return (uint8_t) (recorderValues[index] >> 8);
+}
+
+/*
+ * recorder_write
+ *
+ * Write one EEPROM byte, skipping the write if it already holds the data.
+ */
+static void recorder_write(uint8_t location, uint8_t data)
+{
+    CLRWDT();
+    if (eeprom_read_register(location) != data)
+        eeprom_write_register(location, data);
+}
+
+/*
+ * recorder_save
+ *
+ * Keep a snapshot of the log in EEPROM. Only bytes that differ are written,
+ * and events past the end of a partly full log are left as they were.
+ */
+void recorder_save(void)
+{
+    uint8_t i;
+    uint8_t data;
+    uint8_t len = 1 + 3 * recorderCount;
+    uint16_t crc = DATABASE_SEED;
+
+    for (i = 0; i < len; i++)
+    {
+        data = recorder_snapshot_byte(i);
+        crc = crc16(&data, 1, crc);
+        recorder_write(RECORDER_EEPROM_LOC + i, data);
+    }
+
+    recorder_write(RECORDER_EEPROM_LOC + RECORDER_EEPROM_LEN - 2, (uint8_t) crc);
+    recorder_write(RECORDER_EEPROM_LOC + RECORDER_EEPROM_LEN - 1, (uint8_t) (crc >> 8));
+}
+
+/*
+ * recorder_dump_saved
+ *
+ * Send the EEPROM snapshot over the UART, oldest first. Nothing is sent if
+ * there is no valid snapshot.
+ */
+void recorder_dump_saved(void)
+{
+    uint8_t i;
+    uint8_t data;
+    uint8_t count = eeprom_read_register(RECORDER_EEPROM_LOC);
+    uint8_t location;
+    uint16_t crc = DATABASE_SEED;
+
+    if (count > RECORDER_LEN)
+        return;
+
+    for (i = 0; i < 1 + 3 * count; i++)
+    {
+        data = eeprom_read_register(RECORDER_EEPROM_LOC + i);
+        crc = crc16(&data, 1, crc);
+    }
+
+    if (eeprom_read_register(RECORDER_EEPROM_LOC + RECORDER_EEPROM_LEN - 2) != (uint8_t) crc ||
+            eeprom_read_register(RECORDER_EEPROM_LOC + RECORDER_EEPROM_LEN - 1) != (uint8_t) (crc >> 8))
+        return;
+
+    recorder_send(RECORDER_DUMP, RECORDER_DUMP_EEPROM);
+    for (i = 0; i < count; i++)
+    {
+        location = RECORDER_EEPROM_LOC + 1 + 3 * i;
+        recorder_send(eeprom_read_register(location),
+                eeprom_read_register(location + 1) |
+                ((uint16_t) eeprom_read_register(location + 2) << 8));
+    }
+}
+
+#endif
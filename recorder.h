@@ -0,0 +1,70 @@
+/*
+ * File:   recorder.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:33 AM
+ */
+
+#ifndef RECORDER_H
+#define	RECORDER_H
+
+#include "database.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Set to 0 to remove the flight recorder from the build
+#ifndef RECORDER_ENABLED
+#define RECORDER_ENABLED    1
+#endif
+
+// Number of events kept. Must be a power of two.
+#define RECORDER_LEN        16
+
+// Event types
+#define RECORDER_RESET      0x01    // RECORDER_RESET_* flags
+#define RECORDER_READING    0x02    // Echo time in us
+#define RECORDER_STATE      0x03    // APP_STATE_*
+#define RECORDER_BATTERY    0x04    // Battery millivolts
+#define RECORDER_ERROR      0x05    // TELEMETRY_ERROR_*
+#define RECORDER_DUMP       0x06    // Start of a dump, RECORDER_DUMP_*
+
+// Where a dump comes from
+#define RECORDER_DUMP_RAM       0
+#define RECORDER_DUMP_EEPROM    1
+
+// Reset causes, decoded from STATUS and PCON
+#define RECORDER_RESET_POWER_ON     0x01
+#define RECORDER_RESET_BROWN_OUT    0x02
+#define RECORDER_RESET_WATCHDOG     0x04
+#define RECORDER_RESET_MCLR         0x08
+#define RECORDER_RESET_INSTRUCTION  0x10
+#define RECORDER_RESET_STACK        0x20
+
+// Causes worth keeping a snapshot of in EEPROM
+#define RECORDER_RESET_ABNORMAL     (RECORDER_RESET_WATCHDOG | RECORDER_RESET_STACK)
+
+// The snapshot sits in the EEPROM after the database ring: count, types,
+// values and a CRC-16
+#define RECORDER_EEPROM_LOC     DATABASE_MAX_SIZE
+#define RECORDER_EEPROM_LEN     (1 + 3 * RECORDER_LEN + 2)
+
+#if RECORDER_ENABLED
+void recorder_init(void);
+void recorder_log(uint8_t type, uint16_t value);
+uint8_t recorder_reset_cause(void);
+bool recorder_restored(void);
+void recorder_dump(void);
+void recorder_save(void);
+void recorder_dump_saved(void);
+#else
+#define recorder_init()             ((void) 0)
+#define recorder_log(type, value)   ((void) 0)
+#define recorder_reset_cause()      RECORDER_RESET_POWER_ON
+#define recorder_restored()         false
+#define recorder_dump()             ((void) 0)
+#define recorder_save()             ((void) 0)
+#define recorder_dump_saved()       ((void) 0)
+#endif
+
+#endif	/* RECORDER_H */
@@ -0,0 +1,242 @@
+/* 
+ * File:   telemetry.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:20 AM
+ */
+
+#include "telemetry.h"
+
+#if TELEMETRY_ENABLED
+
+#include "constants.h"
+#include "profile.h"
+#include "uart.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Largest record is profile (type + 6 byte payload + CRC) when profiling, or
+// power (type + 5 byte payload + CRC)
+#if PROFILE_ENABLED
+#define TELEMETRY_RECORD_LEN    8
+#else
+#define TELEMETRY_RECORD_LEN    7
+#endif
+// COBS adds one code byte, plus the 0x00 delimiter
+#define TELEMETRY_FRAME_LEN     (TELEMETRY_RECORD_LEN + 2)
+
+// CRC-8 (polynomial 0x07), one entry per nibble
+static const uint8_t crc8Table[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+/*
+ * telemetry_send
+ * 
+ * Append the CRC to a record, COBS encode it and queue the frame. Dropped if 
+ * the UART queue is full.
+ * 
+ * Input:
+ *      record  Type and payload, with one spare byte at the end for the CRC
+ *      len     Length of the type and payload
+ */
+static void telemetry_send(uint8_t *record, uint8_t len)
+{
+    uint8_t frame[TELEMETRY_FRAME_LEN];
+    uint8_t crc = 0;
+    uint8_t code = 1;
+    uint8_t codeIndex = 0;
+    uint8_t out = 1;
+    uint8_t i;
+    
+    for (i = 0; i < len; i++)
+    {
+        crc = (uint8_t) (crc << 4) ^ crc8Table[(crc ^ record[i]) >> 4];
+        crc = (uint8_t) (crc << 4) ^ crc8Table[(crc >> 4) ^ (record[i] & 0x0F)];
+    }
+    record[len++] = crc;
+    
+    // Replace every zero with the distance to the next one
+    for (i = 0; i < len; i++)
+    {
+        if (record[i] == 0)
+        {
+            frame[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        }
+        else
+        {
+            frame[out++] = record[i];
+            code++;
+        }
+    }
+    frame[codeIndex] = code;
+    frame[out++] = 0x00;
+    
+    UART_enqueue(frame, out);
+}
+
+/*
+ * telemetry_init
+ * 
+ * Start the UART transmitter for telemetry.
+ */
+void telemetry_init(void)
+{
+    UART_init(TELEMETRY_BAUD_RATE, _XTAL_FREQ, true, false);
+}
+
+/*
+ * telemetry_reading
+ * 
+ * Report a new echo reading in microseconds.
+ */
+void telemetry_reading(uint16_t reading)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_READING;
+    record[1] = (uint8_t) reading;
+    record[2] = (uint8_t) (reading >> 8);
+    telemetry_send(record, 3);
+}
+
+/*
+ * telemetry_state
+ * 
+ * Report a change of application state.
+ */
+void telemetry_state(uint8_t appState)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_STATE;
+    record[1] = appState;
+    telemetry_send(record, 2);
+}
+
+/*
+ * telemetry_battery
+ * 
+ * Report a battery measurement.
+ */
+void telemetry_battery(uint16_t millivolts, uint8_t percent)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_BATTERY;
+    record[1] = (uint8_t) millivolts;
+    record[2] = (uint8_t) (millivolts >> 8);
+    record[3] = percent;
+    telemetry_send(record, 4);
+}
+
+/*
+ * telemetry_calibration
+ * 
+ * Report the outcome of a calibration.
+ * 
+ * Input:
+ *      calibType   APP_CALIB_* that was requested
+ *      result      TELEMETRY_CAL_*
+ *      reading     Filtered reading the calibration was based on
+ */
+void telemetry_calibration(uint8_t calibType, uint8_t result, uint16_t reading)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_CALIBRATION;
+    record[1] = calibType;
+    record[2] = result;
+    record[3] = (uint8_t) reading;
+    record[4] = (uint8_t) (reading >> 8);
+    telemetry_send(record, 5);
+}
+
+/*
+ * telemetry_error
+ * 
+ * Report an error.
+ */
+void telemetry_error(uint8_t code)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_ERROR;
+    record[1] = code;
+    telemetry_send(record, 2);
+}
+
+/*
+ * telemetry_event
+ * 
+ * Report an event from the flight recorder.
+ * 
+ * Input:
+ *      type        RECORDER_*
+ *      value       Value logged with the event
+ */
+void telemetry_event(uint8_t type, uint16_t value)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_EVENT;
+    record[1] = type;
+    record[2] = (uint8_t) value;
+    record[3] = (uint8_t) (value >> 8);
+    telemetry_send(record, 4);
+}
+
+/*
+ * telemetry_power
+ * 
+ * Report how long a power domain has been on.
+ * 
+ * Input:
+ *      domain      Bit number of the POWER_* domain, or POWER_DOMAINS for
+ *                  the time accounted in total
+ *      ms          Milliseconds on since reset
+ */
+void telemetry_power(uint8_t domain, uint32_t ms)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_POWER;
+    record[1] = domain;
+    record[2] = (uint8_t) ms;
+    record[3] = (uint8_t) (ms >> 8);
+    record[4] = (uint8_t) (ms >> 16);
+    record[5] = (uint8_t) (ms >> 24);
+    telemetry_send(record, 6);
+}
+
+#if PROFILE_ENABLED
+/*
+ * telemetry_profile
+ * 
+ * Report one statistic for a profiled region.
+ * 
+ * Input:
+ *      region      PROFILE_* region
+ *      stat        PROFILE_STAT_*
+ *      value       Count, or microseconds awake
+ */
+void telemetry_profile(uint8_t region, uint8_t stat, uint32_t value)
+{
+    uint8_t record[TELEMETRY_RECORD_LEN];
+    
+    record[0] = TELEMETRY_TYPE_PROFILE;
+    record[1] = region;
+    record[2] = stat;
+    record[3] = (uint8_t) value;
+    record[4] = (uint8_t) (value >> 8);
+    record[5] = (uint8_t) (value >> 16);
+    record[6] = (uint8_t) (value >> 24);
+    telemetry_send(record, 7);
+}
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/* 
+ * File:   telemetry.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:20 AM
+ */
+
+#ifndef TELEMETRY_H
+#define	TELEMETRY_H
+
+#include <stdint.h>
+
+// Set to 0 to remove telemetry (and the UART) from the build
+#ifndef TELEMETRY_ENABLED
+#define TELEMETRY_ENABLED   1
+#endif
+
+#define TELEMETRY_BAUD_RATE 19200
+
+/*
+ * Records are sent as COBS frames terminated by 0x00. Before encoding, each
+ * record is: type (1 byte), payload (little endian), CRC-8 (1 byte, 
+ * polynomial 0x07, initial value 0x00) over the type and payload. 
+ * tools/telemetry_decode.py turns a capture back into text.
+ */
+#define TELEMETRY_TYPE_READING      0x01    // uint16_t echo time in us
+#define TELEMETRY_TYPE_STATE        0x02    // uint8_t APP_STATE_*
+#define TELEMETRY_TYPE_BATTERY      0x03    // uint16_t millivolts, uint8_t percent
+#define TELEMETRY_TYPE_CALIBRATION  0x04    // uint8_t type, uint8_t result, uint16_t reading
+#define TELEMETRY_TYPE_ERROR        0x05    // uint8_t TELEMETRY_ERROR_*
+#define TELEMETRY_TYPE_EVENT        0x06    // uint8_t RECORDER_*, uint16_t value
+#define TELEMETRY_TYPE_PROFILE      0x07    // uint8_t region, uint8_t PROFILE_STAT_*, uint32_t value
+#define TELEMETRY_TYPE_POWER        0x08    // uint8_t domain, uint32_t ms on
+
+// Calibration results
+#define TELEMETRY_CAL_OK            0
+#define TELEMETRY_CAL_UNSTABLE      1
+#define TELEMETRY_CAL_TOO_CLOSE     2
+
+// Error codes
+#define TELEMETRY_ERROR_NO_READING  1
+#define TELEMETRY_ERROR_STANDBY     2
+
+#if TELEMETRY_ENABLED
+void telemetry_init(void);
+void telemetry_reading(uint16_t reading);
+void telemetry_state(uint8_t appState);
+void telemetry_battery(uint16_t millivolts, uint8_t percent);
+void telemetry_calibration(uint8_t calibType, uint8_t result, uint16_t reading);
+void telemetry_error(uint8_t code);
+void telemetry_event(uint8_t type, uint16_t value);
+void telemetry_profile(uint8_t region, uint8_t stat, uint32_t value);
+void telemetry_power(uint8_t domain, uint32_t ms);
+#else
+#define telemetry_init()
+#define telemetry_reading(reading)
+#define telemetry_state(appState)
+#define telemetry_battery(millivolts, percent)
+#define telemetry_calibration(calibType, result, reading)
+#define telemetry_error(code)
+#define telemetry_event(type, value)
+#define telemetry_profile(region, stat, value)
+#define telemetry_power(domain, ms)
+#endif
+
+#endif	/* TELEMETRY_H */
@@ -0,0 +1,378 @@
+#!/usr/bin/env python3
+"""
+Benchmark the XC8 build of the firmware under gpsim.
+
+A replay trace (see tools/replay/replay.c for the format) is turned into
+gpsim stimuli: echo pulses on RA2, presses of the yellow (RB4) and red (RB5)
+buttons and the battery voltage on RC1. The firmware is built with
+PROFILE_BENCH=1, so every profiling marker writes its region to profileMark,
+and gpsim logs those writes against its cycle count. From the log this
+reports the instruction cycles taken by each region and by one pass of the
+main loop in each application state, then combines them with the current
+model below to estimate the charge drawn over the trace.
+
+The firmware is built with CLOCK_SCALING=0, so it stays at 4MHz and one
+instruction cycle is one microsecond. The charge model puts processing back
+at CLOCK_FAST and awake waits at CLOCK_SLOW, as the real firmware runs them.
+
+The echo is a free running pulse train rather than an answer to each
+trigger, which only moves a reading by up to one pulse period.
+
+Usage:
+    bench.py --cod build/bench.cod ../replay/traces/park.trace
+    bench.py --log build/park.log ../replay/traces/park.trace
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# Mirrors APP_STATE_* in main.c
+APP_STATES = ["DISPLAY", "STANDBY", "CALIB", "ENTER_DISPLAY", "ENTER_STANDBY",
+              "ENTER_CALIB", "INDEFINITE_SLEEP"]
+
+# Regions written to profileMark, see profile.h
+REGION_ISR = 0
+REGION_SET_LIGHTS = 1
+REGION_DB_SAVE = 2
+REGION_MAIN_LOOP = 3
+REGION_STATE = 4
+REGION_MEDIAN = REGION_STATE + len(APP_STATES)
+REGION_DB_INIT = REGION_MEDIAN + 1
+REGION_WAIT = REGION_MEDIAN + 2
+REGION_SLEEP = REGION_MEDIAN + 3
+MARK_END = 0x80
+
+REGIONS = [
+    (REGION_ISR, "ISR()"),
+    (REGION_MEDIAN, "median5()"),
+    (REGION_SET_LIGHTS, "TLC5926_SetLights()"),
+    (REGION_DB_SAVE, "db_save()"),
+    (REGION_DB_INIT, "db_init()"),
+]
+
+# Instruction cycles per microsecond in the bench build
+CYCLES_PER_US = 1
+
+# Processing runs at CLOCK_FAST (16MHz), four times the bench
+FAST_CYCLES_PER_US = 4
+
+# Current model in mA. The PIC figures are typical for a PIC16F1828 at 3.3V
+# from HFINTOSC, and the rest are for the parts on the board. Check them
+# against the datasheets for the supply in use.
+IDD_FAST_MA = 1.7           # Core at 16MHz, processing
+IDD_SLOW_MA = 0.25          # Core at 1MHz, awake waits
+IPD_MA = 0.025              # SLEEP with the watchdog and LDO
+SENSOR_MA = 2.0             # HC-SR04 powered
+LEDS_MA = 5 * 10.0 + 6.0    # TLC5926 with five LED's lit at 10mA each
+
+# Current drawn outside the PIC in each state while awake and while asleep.
+# Mirrors the power column of the state table in main.c. Standby releases
+# the sensor while it sleeps.
+STATE_MA = {
+    "DISPLAY": (SENSOR_MA + LEDS_MA, SENSOR_MA + LEDS_MA),
+    "STANDBY": (SENSOR_MA, 0.0),
+    "CALIB": (SENSOR_MA + LEDS_MA, SENSOR_MA + LEDS_MA),
+    "ENTER_DISPLAY": (SENSOR_MA + LEDS_MA, SENSOR_MA + LEDS_MA),
+    "ENTER_STANDBY": (SENSOR_MA, SENSOR_MA),
+    "ENTER_CALIB": (SENSOR_MA + LEDS_MA, SENSOR_MA + LEDS_MA),
+    "INDEFINITE_SLEEP": (0.0, 0.0),
+}
+
+# Stimuli
+ECHO_GAP_US = 2000          # Low time between echo pulses
+BUTTON_US = 100000          # How long a button is held
+BATTERY_MV = 3300           # Battery until the trace sets one
+TAIL_US = 30000000          # Run after the last line without an end
+
+TIME_ACTIVE = 0
+TIME_WAIT = 1
+TIME_SLEEP = 2
+
+
+def read_trace(path):
+    """Trace lines as (us, command, arguments), in time order."""
+    lines = []
+
+    with open(path) as trace:
+        for number, line in enumerate(trace, 1):
+            words = line.split("#", 1)[0].split()
+            if not words:
+                continue
+            if len(words) < 2:
+                sys.exit("%s:%d: expected <ms> <command>" % (path, number))
+            lines.append((int(words[0]) * 1000, words[1], words[2:]))
+
+    lines.sort(key=lambda line: line[0])
+    return lines
+
+
+def trace_end(lines):
+    for us, command, _ in lines:
+        if command == "end":
+            return us
+    return (lines[-1][0] if lines else 0) + TAIL_US
+
+
+def echo_edges(lines, end):
+    """Cycles at which the echo changes, starting low."""
+    edges = []
+    changes = [(us, command) for us, command, _ in lines
+               if command not in ("button", "battery", "end")]
+    now = 0
+    width = None
+
+    for index, (us, command) in enumerate(changes):
+        width = None if command == "none" else int(command)
+        until = changes[index + 1][0] if index + 1 < len(changes) else end
+        now = max(now, us)
+
+        while width is not None and now + width < until:
+            edges += [now * CYCLES_PER_US, (now + width) * CYCLES_PER_US]
+            now += width + ECHO_GAP_US
+
+    return edges
+
+
+def stimulus(name, initial, values):
+    """gpsim asynchronous stimulus, a flat list of cycle and value pairs."""
+    out = ["stimulus asynchronous_stimulus",
+           "initial_state %s" % initial,
+           "start_cycle 0"]
+    pairs = ["%d, %s" % (cycle, value) for cycle, value in values]
+    out.append("{ " + ",\n  ".join(pairs or ["0, %s" % initial]) + " }")
+    out += ["name %s" % name, "end"]
+    return out
+
+
+def write_script(lines, end, log, path, stc):
+    edges = echo_edges(lines, end)
+    echo = [(cycle, index % 2 ^ 1) for index, cycle in enumerate(edges)]
+    buttons = {"yellow": [], "red": []}
+    battery = []
+
+    for us, command, args in lines:
+        if command == "button":
+            cycle = us * CYCLES_PER_US
+            buttons[args[0]] += [(cycle, 0), (cycle + BUTTON_US, 1)]
+        elif command == "battery":
+            battery.append((us * CYCLES_PER_US, "%.3f" % (int(args[0]) / 1000)))
+
+    out = ["# Generated by tools/bench/bench.py from %s" % path]
+    out += stimulus("echo", 0, echo)
+    out += stimulus("yellow", 1, buttons["yellow"])
+    out += stimulus("red", 1, buttons["red"])
+    out += stimulus("battery", "%.3f" % (BATTERY_MV / 1000), battery)
+    for name, pin in (("echo", "porta2"), ("yellow", "portb4"),
+                      ("red", "portb5"), ("battery", "portc1")):
+        out += ["node n_%s" % name, "attach n_%s %s %s" % (name, name, pin)]
+
+    out += ["frequency %d" % (CYCLES_PER_US * 4000000),
+            "log on %s" % log,
+            "log w _profileMark",
+            "break c %d" % (end * CYCLES_PER_US),
+            "run",
+            "log off",
+            "quit"]
+
+    with open(stc, "w") as script:
+        script.write("\n".join(out) + "\n")
+
+
+def run_gpsim(args, stc):
+    command = [args.gpsim, "-i"]
+    if args.processor:
+        command += ["-p", args.processor]
+    command += ["-s", args.cod, "-c", stc]
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+
+
+# A write to profileMark: the cycle count leads the line and the value
+# follows "wrote". gpsim versions differ in the rest.
+LOG_WRITE = re.compile(r"^\s*(0x[0-9a-fA-F]+|\d+)\b.*?\bwr\w*:?\s*"
+                       r"(0x[0-9a-fA-F]+|\d+)")
+
+
+def read_marks(path):
+    marks = []
+
+    with open(path) as log:
+        for line in log:
+            match = LOG_WRITE.match(line)
+            if match:
+                marks.append((int(match.group(1), 0), int(match.group(2), 0)))
+
+    return marks
+
+
+class Frame:
+    def __init__(self, region, start):
+        self.region = region
+        self.start = start
+        self.times = [0, 0, 0]
+
+
+class Stats:
+    def __init__(self):
+        self.values = []
+
+    def add(self, value):
+        self.values.append(value)
+
+    def row(self, name):
+        v = self.values
+        if not v:
+            return "%-22s %6d" % (name, 0)
+        return "%-22s %6d %9d %9.0f %9d" % (name, len(v), min(v),
+                                           sum(v) / len(v), max(v))
+
+
+def analyse(marks):
+    """Cycles per region and per state pass, and time by state."""
+    regions = {region: Stats() for region, _ in REGIONS}
+    passes = [Stats() for _ in APP_STATES]
+    state_times = [[0, 0, 0] for _ in APP_STATES]
+    other_times = [0, 0, 0]
+    stack = []
+    last = marks[0][0] if marks else 0
+
+    for cycle, mark in marks:
+        # The time since the last mark, by the innermost of ISR, WAIT and
+        # SLEEP. The ISR is processing even when it wakes a wait.
+        kind = TIME_ACTIVE
+        for frame in reversed(stack):
+            if frame.region == REGION_WAIT:
+                kind = TIME_WAIT
+            elif frame.region == REGION_SLEEP:
+                kind = TIME_SLEEP
+            elif frame.region != REGION_ISR:
+                continue
+            break
+        for frame in stack:
+            frame.times[kind] += cycle - last
+        if not any(frame.region == REGION_MAIN_LOOP for frame in stack):
+            other_times[kind] += cycle - last
+        last = cycle
+
+        region = mark & ~MARK_END
+        if not mark & MARK_END:
+            stack.append(Frame(region, cycle))
+            continue
+
+        # A pass of the main loop is ended by its state
+        state = None
+        if REGION_STATE <= region < REGION_MEDIAN:
+            state = region - REGION_STATE
+            region = REGION_MAIN_LOOP
+
+        # Regions left open by a reset are dropped
+        while stack and stack[-1].region != region:
+            stack.pop()
+        if not stack:
+            continue
+        frame = stack.pop()
+
+        if state is not None:
+            passes[state].add(frame.times[TIME_ACTIVE])
+            for kind in range(3):
+                state_times[state][kind] += frame.times[kind]
+        elif region in regions:
+            regions[region].add(cycle - frame.start)
+
+    return regions, passes, state_times, other_times
+
+
+def charge_uah(times, external):
+    """PIC and total charge in uAh for active, wait and sleep cycles."""
+    active_us = times[TIME_ACTIVE] / FAST_CYCLES_PER_US
+    wait_us = times[TIME_WAIT] / CYCLES_PER_US
+    sleep_us = times[TIME_SLEEP] / CYCLES_PER_US
+
+    pic = (active_us * IDD_FAST_MA + wait_us * IDD_SLOW_MA +
+           sleep_us * IPD_MA)
+    board = (active_us + wait_us) * external[0] + sleep_us * external[1]
+
+    # mA us to uAh
+    return pic / 3600.0, (pic + board) / 3600.0
+
+
+def report(path, marks, regions, passes, state_times, other_times):
+    span = (marks[-1][0] - marks[0][0]) / CYCLES_PER_US if marks else 0
+
+    print("== %s, %.3f s simulated" % (path, span / 1e6))
+    print("%-22s %6s %9s %9s %9s" % ("Cycles", "count", "min", "mean", "max"))
+    for region, name in REGIONS:
+        print(regions[region].row(name))
+    print()
+
+    print("%-22s %6s %9s %9s %9s" % ("Active cycles per pass", "count", "min",
+                                    "mean", "max"))
+    for state, name in enumerate(APP_STATES):
+        print(passes[state].row(name))
+    print()
+
+    print("%-22s %9s %9s %9s %9s %9s" % ("Charge by state", "time s",
+                                        "active ms", "wait ms", "uAh PIC",
+                                        "uAh total"))
+    total_pic = 0
+    total = 0
+    for state, name in enumerate(APP_STATES):
+        times = state_times[state]
+        if not any(times):
+            continue
+        pic, board = charge_uah(times, STATE_MA[name])
+        total_pic += pic
+        total += board
+        print("%-22s %9.3f %9.1f %9.1f %9.3f %9.3f" % (
+            name, sum(times) / CYCLES_PER_US / 1e6,
+            times[TIME_ACTIVE] / FAST_CYCLES_PER_US / 1000,
+            times[TIME_WAIT] / CYCLES_PER_US / 1000, pic, board))
+
+    # Init and the few cycles between passes have the sensor on
+    pic, board = charge_uah(other_times, (SENSOR_MA, 0.0))
+    total_pic += pic
+    total += board
+    print("%-22s %9.3f %9.1f %9.1f %9.3f %9.3f" % (
+        "Outside a pass", sum(other_times) / CYCLES_PER_US / 1e6,
+        other_times[TIME_ACTIVE] / FAST_CYCLES_PER_US / 1000,
+        other_times[TIME_WAIT] / CYCLES_PER_US / 1000, pic, board))
+    print("%-22s %39.3f %9.3f" % ("Trace", total_pic, total))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark the firmware under gpsim with a replay trace")
+    parser.add_argument("trace", help="replay trace to drive the pins with")
+    parser.add_argument("--cod", default="build/bench.cod",
+                        help="XC8 output with symbols, built by make")
+    parser.add_argument("--log", help="analyse this gpsim log instead of "
+                        "running gpsim")
+    parser.add_argument("--gpsim", default="gpsim", help="gpsim to run")
+    parser.add_argument("--processor", help="gpsim processor, when it has no "
+                        "model of the PIC16F1828 (e.g. p16f1829)")
+    parser.add_argument("--build", default="build",
+                        help="directory for the script and log")
+    args = parser.parse_args()
+
+    log = args.log
+    if log is None:
+        lines = read_trace(args.trace)
+        name = os.path.splitext(os.path.basename(args.trace))[0]
+        log = os.path.join(args.build, name + ".log")
+        stc = os.path.join(args.build, name + ".stc")
+        os.makedirs(args.build, exist_ok=True)
+        write_script(lines, trace_end(lines), log, args.trace, stc)
+        run_gpsim(args, stc)
+
+    marks = read_marks(log)
+    if not marks:
+        sys.exit("%s: no writes to profileMark, was the firmware built with "
+                 "PROFILE_BENCH=1?" % log)
+
+    report(args.trace, marks, *analyse(marks))
+
+
+if __name__ == "__main__":
+    main()
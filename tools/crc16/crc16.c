@@ -0,0 +1,119 @@
+/*
+ * File:   crc16.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 12:19 PM
+ *
+ * Host check of the database CRC. crc16() from database.c is run against
+ * the published CRC-16/CCITT-FALSE and CRC-16/XMODEM check values, against
+ * a bit at a time reference over random records. A saved record is then
+ * corrupted in a stand-in EEPROM and must be rejected, including swapped
+ * fields that the old additive sum missed.
+ */
+
+// Project includes
+#include "../../database.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_RECORDS      100000
+
+static unsigned char eeprom[256];
+static unsigned failures = 0;
+
+/*
+ * Stand-in EEPROM
+ */
+unsigned char eeprom_read_register(unsigned char address)
+{
+    return eeprom[address];
+}
+
+void eeprom_write_register(unsigned char address, unsigned char data)
+{
+    eeprom[address] = data;
+}
+
+static void expect(bool ok, const char *what)
+{
+    printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (ok == false)
+        failures++;
+}
+
+/*
+ * crc16_bitwise
+ *
+ * CRC-16-CCITT one bit at a time, MSB first.
+ */
+static uint16_t crc16_bitwise(const uint8_t *array, size_t len, uint16_t seed)
+{
+    uint16_t crc = seed;
+    uint8_t bit;
+
+    while (len--)
+    {
+        crc ^= (uint16_t) (*array++ << 8);
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+    }
+
+    return crc;
+}
+
+int main(void)
+{
+    uint8_t check[] = "123456789";
+    uint8_t record[DATABASE_LENGTH];
+    uint8_t saved[DATABASE_LENGTH];
+    unsigned long i;
+    unsigned j;
+    bool ok = true;
+
+    expect(crc16(check, 9, 0xFFFF) == 0x29B1,
+            "\"123456789\" seed 0xFFFF is 0x29B1 (CCITT-FALSE)");
+    expect(crc16(check, 9, 0x0000) == 0x31C3,
+            "\"123456789\" seed 0x0000 is 0x31C3 (XMODEM)");
+
+    srand(1);
+    for (i = 0; i < RANDOM_RECORDS; i++)
+    {
+        for (j = 0; j < DATABASE_LENGTH; j++)
+            record[j] = (uint8_t) rand();
+        ok &= crc16(record, DATABASE_LENGTH, DATABASE_SEED) ==
+                crc16_bitwise(record, DATABASE_LENGTH, DATABASE_SEED);
+    }
+    expect(ok, "Random records match the bit at a time CRC");
+
+    // A saved record reads back, and not once corrupted
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    db_init();
+    db.sdb.rangePointRed = 0x1234;
+    db.sdb.rangePointYellow = 0x5678;
+    db_save();
+    memcpy(saved, eeprom, DATABASE_LENGTH);
+    expect(db_read(0) == true && db.sdb.rangePointRed == 0x1234 &&
+            db.sdb.rangePointYellow == 0x5678, "Saved record reads back");
+
+    // Swapped range points, which the sum of the bytes couldn't see
+    eeprom[4] = saved[6]; eeprom[5] = saved[7];
+    eeprom[6] = saved[4]; eeprom[7] = saved[5];
+    expect(db_read(0) == false, "Swapped range points are rejected");
+
+    // Every single bit flipped
+    ok = true;
+    for (i = 0; i < DATABASE_LENGTH * 8; i++)
+    {
+        memcpy(eeprom, saved, DATABASE_LENGTH);
+        eeprom[i / 8] ^= (uint8_t) (1 << (i % 8));
+        ok &= db_read(0) == false;
+    }
+    expect(ok, "Every single bit error is rejected");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * File:   count.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 12:18 PM
+ *
+ * Counting compare-exchange for utils.c, included ahead of utils.h.
+ */
+
+#ifndef COUNT_H
+#define	COUNT_H
+
+#include <stdint.h>
+
+extern unsigned long cmpCount;
+extern unsigned long swapCount;
+
+#define CMP_SWAP(a, b)  do { \
+        cmpCount++; \
+        if ((a) > (b)) { uint16_t t_ = (a); (a) = (b); (b) = t_; swapCount++; } \
+    } while (0)
+
+#endif	/* COUNT_H */
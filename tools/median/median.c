@@ -0,0 +1,167 @@
+/*
+ * File:   median.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 12:18 PM
+ *
+ * Host check and microbenchmark of the median, min and max windows in
+ * utils.c. Each is checked against a reference sort, exhaustively over 0/1
+ * inputs (enough for a sorting network) and over random windows with
+ * duplicates. The compare-exchanges the medians make are counted through
+ * CMP_SWAP(), and every function is timed per call.
+ */
+
+#include "count.h"
+
+// Project includes
+#include "../../utils.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RANDOM_WINDOWS      1000000
+#define TIMED_CALLS         10000000
+
+unsigned long cmpCount = 0;
+unsigned long swapCount = 0;
+
+typedef uint16_t (*window_fn)(const uint16_t *buf);
+
+typedef struct
+{
+    unsigned n;
+    window_fn median;
+    window_fn min;
+    window_fn max;
+} window_size;
+
+static const window_size sizes[] = {
+    {3, median3, min3, max3},
+    {5, median5, min5, max5},
+    {7, median7, min7, max7},
+    {9, median9, min9, max9},
+};
+
+#define SIZES   (sizeof(sizes) / sizeof(sizes[0]))
+
+static int compare_u16(const void *a, const void *b)
+{
+    return (int) *(const uint16_t *) a - (int) *(const uint16_t *) b;
+}
+
+/*
+ * check
+ *
+ * Compare one window against the reference sort.
+ */
+static bool check(const window_size *size, const uint16_t *buf)
+{
+    uint16_t sorted[9];
+    unsigned i;
+
+    for (i = 0; i < size->n; i++)
+        sorted[i] = buf[i];
+    qsort(sorted, size->n, sizeof(sorted[0]), compare_u16);
+
+    if (size->median(buf) != sorted[size->n / 2] ||
+            size->min(buf) != sorted[0] ||
+            size->max(buf) != sorted[size->n - 1])
+    {
+        fprintf(stderr, "size %u wrong for", size->n);
+        for (i = 0; i < size->n; i++)
+            fprintf(stderr, " %u", buf[i]);
+        fprintf(stderr, "\n");
+        return false;
+    }
+
+    return true;
+}
+
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * ns_per_call
+ *
+ * Time a function over a few windows, summing the results so the calls
+ * can't be optimised away.
+ */
+static double ns_per_call(window_fn fn, uint16_t windows[][9])
+{
+    volatile uint16_t sink;
+    uint32_t sum = 0;
+    double start = seconds();
+    unsigned long i;
+
+    for (i = 0; i < TIMED_CALLS; i++)
+        sum += fn(windows[i & 63]);
+    sink = (uint16_t) sum;
+    (void) sink;
+
+    return (seconds() - start) * 1e9 / TIMED_CALLS;
+}
+
+int main(void)
+{
+    static uint16_t windows[64][9];
+    uint16_t buf[9];
+    unsigned long pattern;
+    unsigned long calls;
+    double compares;
+    double swaps;
+    unsigned s;
+    unsigned i;
+    bool ok = true;
+
+    srand(1);
+    for (i = 0; i < 64 * 9; i++)
+        windows[i / 9][i % 9] = (uint16_t) (rand() % 25000);
+
+    printf("%-6s %12s %12s %12s %10s %10s %10s\n", "Window", "cmp/call",
+            "swap/call", "median ns", "min ns", "max ns", "checked");
+
+    for (s = 0; s < SIZES; s++)
+    {
+        const window_size *size = &sizes[s];
+
+        // Every 0/1 window
+        for (pattern = 0; pattern < (1ul << size->n); pattern++)
+        {
+            for (i = 0; i < size->n; i++)
+                buf[i] = (uint16_t) ((pattern >> i) & 1);
+            ok &= check(size, buf);
+        }
+
+        // Random windows with plenty of duplicates, counting as they go
+        cmpCount = 0;
+        swapCount = 0;
+        for (calls = 0; calls < RANDOM_WINDOWS; calls++)
+        {
+            for (i = 0; i < size->n; i++)
+                buf[i] = (uint16_t) (rand() % 16);
+            ok &= check(size, buf);
+        }
+
+        compares = (double) cmpCount / RANDOM_WINDOWS;
+        swaps = (double) swapCount / RANDOM_WINDOWS;
+
+        printf("%-6u %12.1f %12.2f %12.2f %10.2f %10.2f %10lu\n", size->n,
+                compares, swaps, ns_per_call(size->median, windows),
+                ns_per_call(size->min, windows),
+                ns_per_call(size->max, windows),
+                (1ul << size->n) + RANDOM_WINDOWS);
+    }
+
+    printf("min and max make n - 1 compares and no swaps\n");
+    printf("%s\n", ok ? "All windows match the reference sort" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+/*
+ * Host stand-in for the HI-TECH compatibility header.
+ */
+
+#ifndef REPLAY_HTC_H
+#define REPLAY_HTC_H
+
+#include "xc.h"
+
+#endif /* REPLAY_HTC_H */
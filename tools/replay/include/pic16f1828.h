@@ -0,0 +1,127 @@
+/*
+ * Host stand-in for the PIC16F1828 SFRs used by the firmware, for the trace
+ * replay harness. Registers are plain variables, defined once in regs.c.
+ */
+
+#ifndef REPLAY_PIC16F1828_H
+#define REPLAY_PIC16F1828_H
+
+#ifdef REPLAY_DEFINE_REGS
+#define PIC_SFR volatile
+#else
+#define PIC_SFR extern volatile
+#endif
+#define PIC_REG(name, fields) \
+    typedef union { unsigned char byte; struct { fields }; } name##bits_t; \
+    PIC_SFR name##bits_t name##bits;
+
+PIC_REG(OSCCON, unsigned SCS:2; unsigned :1; unsigned IRCF:4; unsigned SPLLEN:1;)
+#define OSCCON OSCCONbits.byte
+PIC_REG(OSCSTAT, unsigned HFIOFS:1; unsigned LFIOFR:1; unsigned MFIOFR:1; unsigned HFIOFL:1; unsigned HFIOFR:1; unsigned OSTS:1; unsigned PLLR:1; unsigned T1OSCR:1;)
+#define OSCSTAT OSCSTATbits.byte
+PIC_REG(WDTCON, unsigned SWDTEN:1; unsigned WDTPS:5;)
+#define WDTCON WDTCONbits.byte
+PIC_REG(STATUS, unsigned C:1; unsigned DC:1; unsigned Z:1; unsigned nPD:1; unsigned nTO:1;)
+#define STATUS STATUSbits.byte
+PIC_REG(PCON, unsigned nBOR:1; unsigned nPOR:1; unsigned nRI:1; unsigned nRMCLR:1; unsigned :2; unsigned STKUNF:1; unsigned STKOVF:1;)
+#define PCON PCONbits.byte
+PIC_REG(INTCON, unsigned IOCIF:1; unsigned INTF:1; unsigned TMR0IF:1; unsigned IOCIE:1; unsigned INTE:1; unsigned TMR0IE:1; unsigned PEIE:1; unsigned GIE:1;)
+#define INTCON INTCONbits.byte
+#define T0IE TMR0IE
+PIC_REG(OPTION_REG, unsigned PS:3; unsigned PSA:1; unsigned TMR0SE:1; unsigned TMR0CS:1; unsigned INTEDG:1; unsigned nWPUEN:1;)
+#define OPTION_REG OPTION_REGbits.byte
+PIC_REG(PIE1, unsigned TMR1IE:1; unsigned TMR2IE:1; unsigned CCP1IE:1; unsigned SSP1IE:1; unsigned TXIE:1; unsigned RCIE:1; unsigned ADIE:1; unsigned TMR1GIE:1;)
+#define PIE1 PIE1bits.byte
+PIC_REG(PIR1, unsigned TMR1IF:1; unsigned TMR2IF:1; unsigned CCP1IF:1; unsigned SSP1IF:1; unsigned TXIF:1; unsigned RCIF:1; unsigned ADIF:1; unsigned TMR1GIF:1;)
+#define PIR1 PIR1bits.byte
+PIC_REG(PIE2, unsigned CCP2IE:1; unsigned :2; unsigned BCL1IE:1; unsigned EEIE:1; unsigned C1IE:1; unsigned C2IE:1; unsigned OSFIE:1;)
+PIC_REG(PIR2, unsigned CCP2IF:1; unsigned :2; unsigned BCL1IF:1; unsigned EEIF:1; unsigned C1IF:1; unsigned C2IF:1; unsigned OSFIF:1;)
+PIC_REG(PIE3, unsigned :1; unsigned TMR4IE:1; unsigned :1; unsigned TMR6IE:1; unsigned CCP3IE:1; unsigned CCP4IE:1;)
+PIC_REG(PIR3, unsigned :1; unsigned TMR4IF:1; unsigned :1; unsigned TMR6IF:1; unsigned CCP3IF:1; unsigned CCP4IF:1;)
+#define PIE3 PIE3bits.byte
+#define PIR3 PIR3bits.byte
+PIC_REG(IOCAP, unsigned IOCAP0:1; unsigned IOCAP1:1; unsigned IOCAP2:1; unsigned IOCAP3:1; unsigned IOCAP4:1; unsigned IOCAP5:1;)
+PIC_REG(IOCAN, unsigned IOCAN0:1; unsigned IOCAN1:1; unsigned IOCAN2:1; unsigned IOCAN3:1; unsigned IOCAN4:1; unsigned IOCAN5:1;)
+PIC_REG(IOCAF, unsigned IOCAF0:1; unsigned IOCAF1:1; unsigned IOCAF2:1; unsigned IOCAF3:1; unsigned IOCAF4:1; unsigned IOCAF5:1;)
+PIC_REG(IOCBP, unsigned :4; unsigned IOCBP4:1; unsigned IOCBP5:1; unsigned IOCBP6:1; unsigned IOCBP7:1;)
+PIC_REG(IOCBN, unsigned :4; unsigned IOCBN4:1; unsigned IOCBN5:1; unsigned IOCBN6:1; unsigned IOCBN7:1;)
+PIC_REG(IOCBF, unsigned :4; unsigned IOCBF4:1; unsigned IOCBF5:1; unsigned IOCBF6:1; unsigned IOCBF7:1;)
+#define IOCAF IOCAFbits.byte
+#define IOCBF IOCBFbits.byte
+PIC_REG(WPUA, unsigned WPUA0:1; unsigned WPUA1:1; unsigned WPUA2:1; unsigned WPUA3:1; unsigned WPUA4:1; unsigned WPUA5:1;)
+PIC_REG(PORTA, unsigned RA0:1; unsigned RA1:1; unsigned RA2:1; unsigned RA3:1; unsigned RA4:1; unsigned RA5:1;)
+PIC_REG(PORTB, unsigned :4; unsigned RB4:1; unsigned RB5:1; unsigned RB6:1; unsigned RB7:1;)
+PIC_REG(PORTC, unsigned RC0:1; unsigned RC1:1; unsigned RC2:1; unsigned RC3:1; unsigned RC4:1; unsigned RC5:1; unsigned RC6:1; unsigned RC7:1;)
+#define PORTA PORTAbits.byte
+#define PORTB PORTBbits.byte
+#define PORTC PORTCbits.byte
+#define RA2 PORTAbits.RA2
+#define RB4 PORTBbits.RB4
+#define RB5 PORTBbits.RB5
+#define RC1 PORTCbits.RC1
+PIC_REG(LATA, unsigned LATA0:1; unsigned LATA1:1; unsigned LATA2:1; unsigned :1; unsigned LATA4:1; unsigned LATA5:1;)
+PIC_REG(LATB, unsigned :4; unsigned LATB4:1; unsigned LATB5:1; unsigned LATB6:1; unsigned LATB7:1;)
+PIC_REG(LATC, unsigned LATC0:1; unsigned LATC1:1; unsigned LATC2:1; unsigned LATC3:1; unsigned LATC4:1; unsigned LATC5:1; unsigned LATC6:1; unsigned LATC7:1;)
+#define LATA LATAbits.byte
+#define LATB LATBbits.byte
+#define LATC LATCbits.byte
+PIC_REG(TRISA, unsigned TRISA0:1; unsigned TRISA1:1; unsigned TRISA2:1; unsigned TRISA3:1; unsigned TRISA4:1; unsigned TRISA5:1;)
+PIC_REG(TRISB, unsigned :4; unsigned TRISB4:1; unsigned TRISB5:1; unsigned TRISB6:1; unsigned TRISB7:1;)
+PIC_REG(TRISC, unsigned TRISC0:1; unsigned TRISC1:1; unsigned TRISC2:1; unsigned TRISC3:1; unsigned TRISC4:1; unsigned TRISC5:1; unsigned TRISC6:1; unsigned TRISC7:1;)
+#define TRISA TRISAbits.byte
+#define TRISB TRISBbits.byte
+#define TRISC TRISCbits.byte
+PIC_REG(ANSELA, unsigned ANSA0:1; unsigned ANSA1:1; unsigned ANSA2:1; unsigned :1; unsigned ANSA4:1; }; struct { unsigned ANSELA:8;)
+PIC_REG(ANSELB, unsigned :4; unsigned ANSB4:1; unsigned ANSB5:1;)
+PIC_REG(ANSELC, unsigned ANSC0:1; unsigned ANSC1:1; unsigned ANSC2:1; unsigned ANSC3:1; unsigned :2; unsigned ANSC6:1; unsigned ANSC7:1; }; struct { unsigned ANSELC:8;)
+#define ANSELB ANSELBbits.byte
+PIC_REG(ADCON0, unsigned ADON:1; unsigned GO_nDONE:1; unsigned CHS:5;)
+PIC_REG(ADCON1, unsigned ADPREF:2; unsigned ADNREF:1; unsigned :1; unsigned ADCS:3; unsigned ADFM:1;)
+PIC_REG(ADRESH, unsigned ADRESH:8;)
+PIC_REG(ADRESL, unsigned ADRESL:8;)
+#define ADCON0 ADCON0bits.byte
+#define ADCON1 ADCON1bits.byte
+PIC_REG(FVRCON, unsigned ADFVR:2; unsigned CDAFVR:2; unsigned TSRNG:1; unsigned TSEN:1; unsigned FVRRDY:1; unsigned FVREN:1;)
+#define FVRCON FVRCONbits.byte
+PIC_REG(T1CON, unsigned TMR1ON:1; unsigned :1; unsigned nT1SYNC:1; unsigned T1OSCEN:1; unsigned T1CKPS:2; unsigned TMR1CS:2;)
+#define T1CON T1CONbits.byte
+PIC_SFR unsigned char TMR1L, TMR1H, TMR0;
+PIC_REG(T2CON, unsigned T2CKPS:2; unsigned TMR2ON:1; unsigned T2OUTPS:4;)
+#define T2CON T2CONbits.byte
+PIC_SFR unsigned char TMR2, PR2;
+PIC_REG(CCP1CON, unsigned CCP1M:4; unsigned DC1B:2; unsigned P1M:2;)
+#define CCP1CON CCP1CONbits.byte
+PIC_REG(PSTR1CON, unsigned STR1A:1; unsigned STR1B:1; unsigned STR1C:1; unsigned STR1D:1; unsigned STR1SYNC:1;)
+#define PSTR1CON PSTR1CONbits.byte
+PIC_SFR unsigned char CCPR1L, CCPR1H;
+PIC_REG(CCP2CON, unsigned CCP2M:4; unsigned DC2B:2; unsigned P2M:2;)
+#define CCP2CON CCP2CONbits.byte
+PIC_SFR unsigned char CCPR2L, CCPR2H;
+PIC_REG(CCP3CON, unsigned CCP3M:4; unsigned DC3B:2;)
+#define CCP3CON CCP3CONbits.byte
+PIC_REG(CCP4CON, unsigned CCP4M:4; unsigned DC4B:2;)
+#define CCP4CON CCP4CONbits.byte
+PIC_SFR unsigned char CCPR3L, CCPR3H, CCPR4L, CCPR4H;
+PIC_REG(CCPTMRS, unsigned C1TSEL:2; unsigned C2TSEL:2; unsigned C3TSEL:2; unsigned C4TSEL:2;)
+#define CCPTMRS CCPTMRSbits.byte
+PIC_REG(SSP1STAT, unsigned BF:1; unsigned UA:1; unsigned R_nW:1; unsigned S:1; unsigned P:1; unsigned D_nA:1; unsigned CKE:1; unsigned SMP:1;)
+PIC_REG(SSP1CON1, unsigned SSPM:4; unsigned CKP:1; unsigned SSPEN:1; unsigned SSPOV:1; unsigned WCOL:1;)
+#define SSP1STAT SSP1STATbits.byte
+#define SSP1CON1 SSP1CON1bits.byte
+PIC_SFR unsigned char SSP1BUF;
+PIC_REG(APFCON0, unsigned :2; unsigned TXCKSEL:1; unsigned :2; unsigned SDOSEL:1; unsigned SSSEL:1; unsigned RXDTSEL:1;)
+PIC_REG(APFCON1, unsigned P1BSEL:1; unsigned :7;)
+PIC_REG(EECON1, unsigned RD:1; unsigned WR:1; unsigned WREN:1; unsigned WRERR:1; unsigned FREE:1; unsigned LWLO:1; unsigned CFGS:1; unsigned EEPGD:1;)
+PIC_SFR unsigned char EEADR, EEADRL, EEADRH, EEDATA, EEDATL, EECON2;
+PIC_REG(TXSTA, unsigned TX9D:1; unsigned TRMT:1; unsigned BRGH:1; unsigned SENDB:1; unsigned SYNC:1; unsigned TXEN:1; unsigned TX9:1; unsigned CSRC:1;)
+PIC_REG(RCSTA, unsigned RX9D:1; unsigned OERR:1; unsigned FERR:1; unsigned ADDEN:1; unsigned CREN:1; unsigned SREN:1; unsigned RX9:1; unsigned SPEN:1;)
+PIC_REG(BAUDCON, unsigned ABDEN:1; unsigned WUE:1; unsigned :1; unsigned BRG16:1; unsigned SCKP:1; unsigned :1; unsigned RCIDL:1; unsigned ABDOVF:1;)
+PIC_SFR unsigned char SPBRG, SPBRGL, SPBRGH, TXREG, RCREG;
+#define BRGH TXSTAbits.BRGH
+#define SYNC TXSTAbits.SYNC
+#define TXEN TXSTAbits.TXEN
+#define TRMT TXSTAbits.TRMT
+#define SPEN RCSTAbits.SPEN
+#define CREN RCSTAbits.CREN
+PIC_SFR unsigned char RCIF;
+#endif /* REPLAY_PIC16F1828_H */
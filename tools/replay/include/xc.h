@@ -0,0 +1,35 @@
+/*
+ * Host stand-in for the XC8 compiler header, for the trace replay harness.
+ * Delays, SLEEP and CLRWDT call into the harness so they advance its virtual
+ * clock. CLRWDT takes its one instruction cycle, so a loop waiting awake for
+ * an interrupt moves the clock on. _delay() counts cycles at the speed IRCF
+ * selects, while __delay_us() and __delay_ms() are real time.
+ */
+
+#ifndef REPLAY_XC_H
+#define REPLAY_XC_H
+
+#include <stdint.h>
+
+#include "pic16f1828.h"
+
+void replay_delay_us(uint32_t us);
+void replay_delay_cycles(uint32_t cycles);
+void replay_sleep(void);
+void replay_clrwdt(void);
+void replay_ei(void);
+
+#define interrupt
+#define __persistent
+
+#define CLRWDT()        replay_clrwdt()
+#define SLEEP()         replay_sleep()
+#define NOP()           ((void) 0)
+#define di()            (INTCONbits.GIE = 0)
+#define ei()            replay_ei()
+
+#define __delay_us(x)   replay_delay_us((uint32_t) (x))
+#define __delay_ms(x)   replay_delay_us((uint32_t) (x) * 1000)
+#define _delay(x)       replay_delay_cycles((uint32_t) (x))
+
+#endif /* REPLAY_XC_H */
@@ -0,0 +1,11 @@
+/*
+ * File:   regs.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:31 AM
+ *
+ * Storage for the stand-in SFRs.
+ */
+
+#define REPLAY_DEFINE_REGS
+#include <pic16f1828.h>
@@ -0,0 +1,817 @@
+/*
+ * File:   replay.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:31 AM
+ *
+ * Trace replay harness. The firmware's main() runs on the host against
+ * stand-in registers, with a virtual clock advanced by every delay and SLEEP.
+ * Echoes from a recorded trace are delivered through the real ISR by setting
+ * the CCP3 flag, so the whole state machine sees them as it would on the 
+ * board. The CCP2 event timer and the CCP4 echo timeout are matched against 
+ * TIMER1 the same way. Each sensor answers its own trigger pin on the shared
+ * echo line.
+ * Every LED change and state transition is reported, followed by a summary
+ * of decision latency, LED on-time and how far past the red point the car
+ * is when red lights.
+ *
+ * Trace lines are "<ms> <command>", with # starting a comment:
+ *      <ms> <us>               Echo length every sensor returns from now on
+ *      <ms> none               No echo at all (sensors missing)
+ *      <ms> sensor <n> <us>    Echo length sensor n (1 to 3) returns
+ *      <ms> sensor <n> none    No echo from sensor n
+ *      <ms> button red|yellow  Press a calibration button
+ *      <ms> battery <mV> <%>   Battery seen by the next measurement
+ *      <ms> end                Stop the replay
+ *
+ * The car is taken to be as near as the nearest sensor sees it. Sensors past
+ * HCSR04_SENSORS are left out.
+ */
+
+#include "replay.h"
+
+// Project includes
+#include "../../constants.h"
+#include "../../HCSR04.h"
+#include "../../database.h"
+
+// C libraries
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PIC includes
+#include <xc.h>
+
+void firmware_main(void);
+void ISR(void);
+
+// Delay from the end of the trigger pulse to the start of the echo
+#define ECHO_START_US       450
+
+// How long the trace must stay within PARKED_DIST before the car is parked
+#define PARKED_US           3000000ULL
+#define PARKED_DIST         HCSR04_CM(2)
+
+// Replay time after the last trace line when there is no end command
+#define TAIL_US             30000000ULL
+
+#define TRACE_ECHO          0
+#define TRACE_NONE          1
+#define TRACE_BUTTON        2
+#define TRACE_BATTERY       3
+#define TRACE_END           4
+
+#define BUTTON_YELLOW       0
+#define BUTTON_RED          1
+
+#define ECHO_IDLE           0
+#define ECHO_RISE           1
+#define ECHO_FALL           2
+
+#define COLOUR_OFF          0
+#define COLOUR_GREEN        1
+#define COLOUR_YELLOW       2
+#define COLOUR_RED          3
+
+typedef struct
+{
+    uint64_t time;
+    uint8_t type;
+    uint16_t value;
+    uint16_t extra;
+    uint8_t sensor;         // 1 to 3, or 0 for every sensor
+} trace_line;
+
+// Mirrors APP_STATE_* in main.c
+static const char *appStates[] = {
+    "DISPLAY", "STANDBY", "CALIB", "ENTER_DISPLAY", "ENTER_STANDBY",
+    "ENTER_CALIB", "INDEFINITE_SLEEP",
+};
+
+static const char *colours[] = {"OFF", "GREEN", "YELLOW", "RED"};
+
+static trace_line *trace = NULL;
+static size_t traceLength = 0;
+static size_t traceNext = 0;
+static bool verbose = false;
+
+static jmp_buf replayExit;
+static uint64_t now = 0;
+static uint64_t endTime = 0;
+static uint64_t lastClear = 0;
+static uint16_t timer1 = 0;
+static bool asleep = false;
+
+// Echo each sensor returns, and whether its trigger pin is high
+static bool sensorPresent[HCSR04_SENSORS];
+static uint16_t sensorEcho[HCSR04_SENSORS];
+static bool triggerHigh[HCSR04_SENSORS];
+
+// Nearest echo of the car
+static bool echoPresent = false;
+static uint16_t echoLength = 0;
+
+// Echo on the shared line
+static uint8_t echoSensor = 0;
+static uint8_t echoEvent = ECHO_IDLE;
+static uint64_t echoTime = 0;
+
+// Displayed lights
+static uint16_t lights = 0;
+static uint8_t brightness = 0;
+
+// Clock speeds awake time is split by, in kHz
+static const uint32_t clockKhz[] = {1000, 4000, 16000};
+#define CLOCKS              (sizeof(clockKhz) / sizeof(clockKhz[0]))
+
+// Statistics
+static uint64_t awakeUs = 0;
+static uint64_t awakeClockUs[CLOCKS + 1];
+static uint64_t ledOnUs = 0;
+static uint64_t wastedUs = 0;
+static double ledEnergy = 0;
+static unsigned long readings = 0;
+static unsigned long transitions = 0;
+static bool watchdogReset = false;
+
+// Decision latency against the colour the trace asks for
+static uint16_t parkedEcho = 0;
+static uint64_t parkedSince = 0;
+static uint8_t expectedColour = COLOUR_OFF;
+static bool decisionPending = false;
+static uint64_t decisionSince = 0;
+static unsigned long decisions = 0;
+static unsigned long superseded = 0;
+static uint64_t latencyTotal = 0;
+static uint64_t latencyMax = 0;
+
+// Echo past rangePointRed when red lights after yellow, negative if early
+static unsigned long redChanges = 0;
+static long overshootTotal = 0;
+static long overshootMax = LONG_MIN;
+static long overshootMin = LONG_MAX;
+
+/*
+ * replay_log
+ *
+ * Print a line stamped with the virtual time.
+ */
+void replay_log(const char *format, ...)
+{
+    va_list args;
+
+    printf("%10.3f ", now / 1000.0);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    putchar('\n');
+}
+
+static uint8_t lights_colour(uint16_t bitmap, uint8_t duty)
+{
+    if (bitmap == 0 || duty == 0)
+        return COLOUR_OFF;
+    if (bitmap & LIGHT_RED)
+        return COLOUR_RED;
+    if (bitmap & LIGHT_YELLOW)
+        return COLOUR_YELLOW;
+    return COLOUR_GREEN;
+}
+
+static uint8_t bit_count(uint16_t bitmap)
+{
+    uint8_t count = 0;
+
+    for (; bitmap; bitmap &= bitmap - 1)
+        count++;
+
+    return count;
+}
+
+static void decision_made(void)
+{
+    uint64_t latency = now - decisionSince;
+
+    decisions++;
+    latencyTotal += latency;
+    if (latency > latencyMax)
+        latencyMax = latency;
+    decisionPending = false;
+
+    if (verbose)
+        replay_log("DECISION %s after %.1f ms", colours[expectedColour],
+                latency / 1000.0);
+}
+
+static void red_lit(void)
+{
+    long overshoot = (long) db.sdb.rangePointRed - echoLength;
+
+    redChanges++;
+    overshootTotal += overshoot;
+    if (overshoot > overshootMax)
+        overshootMax = overshoot;
+    if (overshoot < overshootMin)
+        overshootMin = overshoot;
+
+    if (verbose)
+        replay_log("RED %.1f cm past the red point",
+                (double) overshoot / HCSR04_US_PER_CM);
+}
+
+void replay_lights(uint16_t bitmap, uint8_t duty)
+{
+    if (bitmap == lights && duty == brightness)
+        return;
+
+    if (lights_colour(bitmap, duty) == COLOUR_RED &&
+            lights_colour(lights, brightness) == COLOUR_YELLOW &&
+            echoPresent && echoLength <= HCSR04_MAX_READING)
+        red_lit();
+
+    lights = bitmap;
+    brightness = duty;
+    replay_log("LEDS 0x%04X brightness %u", lights, brightness);
+
+    if (decisionPending && lights_colour(lights, brightness) == expectedColour)
+        decision_made();
+}
+
+void replay_reading(uint16_t reading)
+{
+    readings++;
+    if (verbose)
+        replay_log("READING %u", reading);
+}
+
+void replay_state(uint8_t appState)
+{
+    transitions++;
+    replay_log("STATE %s", appState < 7 ? appStates[appState] : "?");
+}
+
+/*
+ * Interrupts
+ */
+static bool interrupt_pending(void)
+{
+    bool peripheral =
+            (PIR3bits.CCP3IF && PIE3bits.CCP3IE) ||
+            (PIR3bits.CCP4IF && PIE3bits.CCP4IE) ||
+            (PIR2bits.CCP2IF && PIE2bits.CCP2IE) ||
+            (PIR1bits.ADIF && PIE1bits.ADIE) ||
+            (PIR1bits.TXIF && PIE1bits.TXIE);
+
+    return (INTCONbits.IOCIF && INTCONbits.IOCIE) ||
+            (peripheral && INTCONbits.PEIE);
+}
+
+// A sleeping core wakes first, and takes the interrupt once it is awake
+static void interrupt_dispatch(void)
+{
+    if (asleep == false && interrupt_pending() && INTCONbits.GIE)
+    {
+        ISR();
+        INTCONbits.IOCIF = (IOCBF != 0);
+    }
+}
+
+/*
+ * Colour the trace asks for, ignoring the display hysteresis
+ */
+static uint8_t trace_colour(uint16_t echo)
+{
+    if (echo > db.sdb.rangePointYellow)
+        return COLOUR_GREEN;
+    if (echo > db.sdb.rangePointRed)
+        return COLOUR_YELLOW;
+    return COLOUR_RED;
+}
+
+static void trace_echo(uint16_t echo)
+{
+    uint8_t colour;
+
+    echoPresent = true;
+    echoLength = echo;
+
+    if ((echo > parkedEcho ? echo - parkedEcho : parkedEcho - echo) > PARKED_DIST)
+    {
+        parkedEcho = echo;
+        parkedSince = now;
+    }
+
+    if (echo > HCSR04_MAX_READING)
+        return;
+
+    colour = trace_colour(echo);
+    if (colour == expectedColour)
+        return;
+
+    if (decisionPending)
+        superseded++;
+
+    expectedColour = colour;
+    decisionSince = now;
+    decisionPending = true;
+    if (lights_colour(lights, brightness) == expectedColour)
+        decision_made();
+}
+
+/*
+ * Set the echo of one sensor, or all of them, and follow the nearest
+ */
+static void trace_sensor(uint8_t sensor, bool present, uint16_t echo)
+{
+    uint8_t i;
+
+    for (i = 0; i < HCSR04_SENSORS; i++)
+    {
+        if (sensor == 0 || sensor == i + 1)
+        {
+            sensorPresent[i] = present;
+            sensorEcho[i] = echo;
+        }
+    }
+
+    present = false;
+    for (i = 0; i < HCSR04_SENSORS; i++)
+    {
+        if (sensorPresent[i] && (present == false || sensorEcho[i] < echo))
+        {
+            present = true;
+            echo = sensorEcho[i];
+        }
+    }
+
+    if (present)
+        trace_echo(echo);
+    else
+        echoPresent = false;
+}
+
+static void trace_apply(const trace_line *line)
+{
+    switch (line->type)
+    {
+        case TRACE_ECHO:
+            trace_sensor(line->sensor, true, line->value);
+            break;
+        case TRACE_NONE:
+            trace_sensor(line->sensor, false, 0);
+            break;
+        case TRACE_BUTTON:
+            replay_log("BUTTON %s", line->value == BUTTON_RED ? "red" : "yellow");
+            if (line->value == BUTTON_RED)
+                IOCBFbits.IOCBF5 = 1;
+            else
+                IOCBFbits.IOCBF4 = 1;
+            INTCONbits.IOCIF = 1;
+            interrupt_dispatch();
+            break;
+        case TRACE_BATTERY:
+            replayBatteryMillivolts = line->value;
+            replayBatteryPercent = (uint8_t) line->extra;
+            break;
+        case TRACE_END:
+            endTime = now;
+            break;
+    }
+}
+
+/*
+ * Sensor. CCP3 only captures in the mode it has been armed for.
+ */
+static void echo_edge(void)
+{
+    uint8_t event = echoEvent;
+
+    echoEvent = ECHO_IDLE;
+
+    if (event == ECHO_RISE && CCP3CONbits.CCP3M == HCSR04_CAPTURE_RISING)
+    {
+        CCPR3H = (uint8_t) (timer1 >> 8);
+        CCPR3L = (uint8_t) timer1;
+        PIR3bits.CCP3IF = 1;
+        interrupt_dispatch();
+
+        echoEvent = ECHO_FALL;
+        echoTime = now + sensorEcho[echoSensor];
+    }
+    else if (event == ECHO_FALL && CCP3CONbits.CCP3M == HCSR04_CAPTURE_FALLING)
+    {
+        CCPR3H = (uint8_t) (timer1 >> 8);
+        CCPR3L = (uint8_t) timer1;
+        PIR3bits.CCP3IF = 1;
+        interrupt_dispatch();
+    }
+}
+
+/*
+ * The CCP4 timeout, which ends an echo that is too long as well as one that
+ * never started
+ */
+static void echo_timeout(void)
+{
+    if (echoEvent == ECHO_FALL)
+        echoEvent = ECHO_IDLE;
+
+    PIR3bits.CCP4IF = 1;
+    interrupt_dispatch();
+}
+
+static bool trigger_pin(uint8_t sensor)
+{
+    if (sensor == 1)
+        return PIN_US_TRIGGER_2;
+    if (sensor == 2)
+        return PIN_US_TRIGGER_3;
+    return PIN_US_TRIGGER;
+}
+
+static void echo_trigger(void)
+{
+    uint8_t i;
+
+    // Powered sensors, with a new rising edge on their trigger pin
+    for (i = 0; i < HCSR04_SENSORS; i++)
+    {
+        if (trigger_pin(i) == 0)
+        {
+            triggerHigh[i] = false;
+            continue;
+        }
+        if (triggerHigh[i] || PIN_ENABLE_HCSR04 == 0)
+            continue;
+
+        triggerHigh[i] = true;
+        if (sensorPresent[i] && echoEvent == ECHO_IDLE)
+        {
+            echoSensor = i;
+            echoEvent = ECHO_RISE;
+            echoTime = now + ECHO_START_US;
+        }
+    }
+}
+
+/*
+ * Virtual clock
+ */
+static uint32_t clock_khz(void)
+{
+    // HFINTOSC, 16MHz down to 125kHz
+    if (OSCCONbits.IRCF >= 0b1000)
+        return 16000 >> (0b1111 - OSCCONbits.IRCF);
+    return 31;
+}
+
+static void account(uint64_t until)
+{
+    uint64_t elapsed = until - now;
+    uint8_t colour = lights_colour(lights, brightness);
+    size_t i;
+
+    if (asleep == false)
+    {
+        awakeUs += elapsed;
+        for (i = 0; i < CLOCKS && clockKhz[i] != clock_khz(); i++)
+            ;
+        awakeClockUs[i] += elapsed;
+        timer1 += (uint16_t) elapsed;
+        TMR1H = (uint8_t) (timer1 >> 8);
+        TMR1L = (uint8_t) timer1;
+    }
+
+    if (colour != COLOUR_OFF)
+    {
+        ledOnUs += elapsed;
+        ledEnergy += elapsed * bit_count(lights) * (brightness / 255.0);
+        if (echoPresent && now - parkedSince >= PARKED_US)
+            wastedUs += elapsed;
+    }
+
+    now = until;
+}
+
+/*
+ * Time a compare matches TIMER1, which only counts while awake
+ */
+static uint64_t match_time(bool armed, uint8_t high, uint8_t low)
+{
+    uint16_t counts = (uint16_t) (((high << 8) | low) - timer1);
+
+    if (asleep || armed == false)
+        return UINT64_MAX;
+
+    return now + (counts ? counts : 0x10000);
+}
+
+static uint64_t compare_time(void)
+{
+    return match_time(PIE2bits.CCP2IE && CCP2CONbits.CCP2M == 0b1010 &&
+            PIR2bits.CCP2IF == 0, CCPR2H, CCPR2L);
+}
+
+static uint64_t timeout_time(void)
+{
+    return match_time(PIE3bits.CCP4IE && 
+            CCP4CONbits.CCP4M == HCSR04_COMPARE_SW_INT &&
+            PIR3bits.CCP4IF == 0, CCPR4H, CCPR4L);
+}
+
+static uint64_t next_event(void)
+{
+    uint64_t next = endTime;
+
+    if (compare_time() < next)
+        next = compare_time();
+    if (timeout_time() < next)
+        next = timeout_time();
+    if (traceNext < traceLength && trace[traceNext].time < next)
+        next = trace[traceNext].time;
+    if (echoEvent != ECHO_IDLE && echoTime < next)
+        next = echoTime;
+
+    return next;
+}
+
+/*
+ * advance
+ *
+ * Run the clock forward to the given time, delivering trace lines and echo
+ * edges on the way. A sleeping core stops at the first interrupt. The replay
+ * ends once the end of the trace is reached.
+ */
+static void advance(uint64_t until)
+{
+    uint64_t next;
+    bool compare;
+    bool timeout;
+
+    while ((next = next_event()) <= until)
+    {
+        compare = (compare_time() == next);
+        timeout = (timeout_time() == next);
+        account(next);
+
+        if (now >= endTime)
+            longjmp(replayExit, 1);
+
+        if (compare)
+        {
+            PIR2bits.CCP2IF = 1;
+            interrupt_dispatch();
+        }
+        else if (timeout)
+            echo_timeout();
+        else if (echoEvent != ECHO_IDLE && echoTime == now)
+            echo_edge();
+        else
+            trace_apply(&trace[traceNext++]);
+
+        if (asleep && interrupt_pending())
+            return;
+    }
+
+    account(until);
+}
+
+static uint64_t watchdog_period(void)
+{
+    return 1000ULL << WDTCONbits.WDTPS;
+}
+
+void replay_delay_us(uint32_t us)
+{
+    echo_trigger();
+    advance(now + us);
+
+    if (WDTCONbits.SWDTEN && now - lastClear > watchdog_period())
+    {
+        replay_log("WATCHDOG RESET");
+        watchdogReset = true;
+        longjmp(replayExit, 1);
+    }
+}
+
+void replay_delay_cycles(uint32_t cycles)
+{
+    uint32_t khz = clock_khz();
+
+    // Four clocks per cycle, rounded up to the next microsecond
+    replay_delay_us((uint32_t) (((uint64_t) cycles * 4000 + khz - 1) / khz));
+}
+
+void replay_clrwdt(void)
+{
+    lastClear = now;
+    replay_delay_cycles(1);
+}
+
+void replay_ei(void)
+{
+    INTCONbits.GIE = 1;
+    interrupt_dispatch();
+}
+
+void replay_sleep(void)
+{
+    uint64_t wake = WDTCONbits.SWDTEN ? now + watchdog_period() : endTime;
+
+    if (interrupt_pending())
+    {
+        STATUSbits.nTO = 1;
+        interrupt_dispatch();
+        return;
+    }
+
+    asleep = true;
+    advance(wake);
+    asleep = false;
+
+    // Woken by an interrupt, otherwise by the watchdog
+    STATUSbits.nTO = interrupt_pending() ? 1 : 0;
+    lastClear = now;
+    interrupt_dispatch();
+}
+
+/*
+ * Trace loading
+ */
+static bool trace_parse(char *text, trace_line *line)
+{
+    char command[16];
+    char argument[16];
+    char extra[16];
+    unsigned long ms;
+    unsigned int value;
+    unsigned int sensor;
+    int fields;
+
+    fields = sscanf(text, "%lu %15s %15s %15s", &ms, command, argument, extra);
+    if (fields < 2)
+        return false;
+
+    line->time = (uint64_t) ms * 1000;
+    line->value = 0;
+    line->extra = 0;
+    line->sensor = 0;
+
+    // One sensor's echo, in the same form as every sensor's
+    if (strcmp(command, "sensor") == 0)
+    {
+        if (fields != 4 || sscanf(argument, "%u", &sensor) != 1 || 
+                sensor < 1 || sensor > 3)
+            return false;
+        line->sensor = (uint8_t) sensor;
+        if (strcmp(extra, "none") == 0)
+            line->type = TRACE_NONE;
+        else if (sscanf(extra, "%u", &value) == 1)
+        {
+            line->type = TRACE_ECHO;
+            line->value = value > 0xFFFF ? 0xFFFF : (uint16_t) value;
+        }
+        else
+            return false;
+        return true;
+    }
+
+    if (strcmp(command, "none") == 0)
+        line->type = TRACE_NONE;
+    else if (strcmp(command, "end") == 0)
+        line->type = TRACE_END;
+    else if (strcmp(command, "button") == 0 && fields >= 3)
+    {
+        line->type = TRACE_BUTTON;
+        line->value = strcmp(argument, "red") == 0 ? BUTTON_RED : BUTTON_YELLOW;
+    }
+    else if (strcmp(command, "battery") == 0 && fields == 4)
+    {
+        line->type = TRACE_BATTERY;
+        line->value = (uint16_t) strtoul(argument, NULL, 10);
+        line->extra = (uint16_t) strtoul(extra, NULL, 10);
+    }
+    else if (sscanf(command, "%u", &value) == 1)
+    {
+        line->type = TRACE_ECHO;
+        line->value = value > 0xFFFF ? 0xFFFF : (uint16_t) value;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+static bool trace_load(FILE *file)
+{
+    char text[128];
+    char *comment;
+    size_t capacity = 0;
+    unsigned long lineNumber = 0;
+    trace_line line;
+
+    while (fgets(text, sizeof(text), file) != NULL)
+    {
+        lineNumber++;
+        if ((comment = strchr(text, '#')) != NULL)
+            *comment = '\0';
+        if (strspn(text, " \t\r\n") == strlen(text))
+            continue;
+
+        if (trace_parse(text, &line) == false)
+        {
+            fprintf(stderr, "line %lu: can't parse trace line\n", lineNumber);
+            return false;
+        }
+        if (traceLength > 0 && line.time < trace[traceLength - 1].time)
+        {
+            fprintf(stderr, "line %lu: trace goes back in time\n", lineNumber);
+            return false;
+        }
+
+        if (traceLength == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            trace = realloc(trace, capacity * sizeof(*trace));
+            if (trace == NULL)
+                return false;
+        }
+        trace[traceLength++] = line;
+    }
+
+    return true;
+}
+
+static void summary(void)
+{
+    size_t i;
+
+    printf("\n");
+    printf("Duration        %10.3f s\n", now / 1e6);
+    printf("Awake           %10.3f s (%.1f%%)\n", awakeUs / 1e6,
+            now ? 100.0 * awakeUs / now : 0);
+    printf("Awake by clock ");
+    for (i = 0; i < CLOCKS; i++)
+        printf(" %luMHz %.3f s,", (unsigned long) clockKhz[i] / 1000,
+                awakeClockUs[i] / 1e6);
+    printf(" other %.3f s\n", awakeClockUs[CLOCKS] / 1e6);
+    printf("Readings        %10lu\n", readings);
+    printf("State changes   %10lu\n", transitions);
+    printf("LED on-time     %10.3f s\n", ledOnUs / 1e6);
+    printf("LED energy      %10.3f LED-s at full brightness\n", ledEnergy / 1e6);
+    printf("Wasted on-time  %10.3f s with the car parked\n", wastedUs / 1e6);
+    printf("Decisions       %10lu, mean %.1f ms, max %.1f ms, %lu superseded, %s\n",
+            decisions, decisions ? latencyTotal / 1000.0 / decisions : 0,
+            latencyMax / 1000.0, superseded,
+            decisionPending ? "last one never shown" : "none outstanding");
+    if (redChanges)
+        printf("Red overshoot   %10lu, mean %.1f cm, from %.1f to %.1f cm past the red point\n",
+                redChanges, (double) overshootTotal / redChanges / HCSR04_US_PER_CM,
+                (double) overshootMin / HCSR04_US_PER_CM,
+                (double) overshootMax / HCSR04_US_PER_CM);
+    else
+        printf("Red overshoot   %10lu\n", redChanges);
+    if (watchdogReset)
+        printf("Stopped by a watchdog reset\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *file;
+    int arg = 1;
+
+    if (arg < argc && strcmp(argv[arg], "-v") == 0)
+    {
+        verbose = true;
+        arg++;
+    }
+    if (arg != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-v] trace\n", argv[0]);
+        return 2;
+    }
+
+    file = strcmp(argv[arg], "-") == 0 ? stdin : fopen(argv[arg], "r");
+    if (file == NULL)
+    {
+        perror(argv[arg]);
+        return 2;
+    }
+    if (trace_load(file) == false)
+        return 2;
+
+    endTime = traceLength ? trace[traceLength - 1].time + TAIL_US : TAIL_US;
+
+    if (setjmp(replayExit) == 0)
+        firmware_main();
+
+    summary();
+
+    return watchdogReset ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * File:   replay.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:31 AM
+ */
+
+#ifndef REPLAY_H
+#define	REPLAY_H
+
+#include <stdint.h>
+
+// Battery state fed to the fuel gauge stand-in
+extern uint16_t replayBatteryMillivolts;
+extern uint8_t replayBatteryPercent;
+
+void replay_log(const char *format, ...);
+void replay_lights(uint16_t bitmap, uint8_t brightness);
+void replay_reading(uint16_t reading);
+void replay_state(uint8_t appState);
+
+#endif	/* REPLAY_H */
@@ -0,0 +1,177 @@
+/*
+ * File:   replay_hw.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:31 AM
+ *
+ * Stand-ins for the drivers that only talk to hardware: the LED driver, the
+ * EEPROM, the UART, the fuel gauge and telemetry. Everything else is built
+ * from the firmware sources.
+ */
+
+#include "replay.h"
+
+// Project includes
+#include "../../TLC5926.h"
+#include "../../EEPROM.h"
+#include "../../battery.h"
+#include "../../telemetry.h"
+#include "../../uart.h"
+
+// C libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+uint16_t replayBatteryMillivolts = 3300;
+uint8_t replayBatteryPercent = 100;
+
+static const char *calibTypes[] = {"NONE", "YELLOW", "RED"};
+static const char *calibResults[] = {"OK", "UNSTABLE", "TOO_CLOSE"};
+static const char *powerDomains[] = {"SENSOR", "LEDS", "ADC", "TOTAL"};
+
+static uint16_t lights = 0;
+static uint8_t brightness = TLC5926_BRIGHTNESS_OFF;
+
+static unsigned char eeprom[256];
+static bool eepromErased = false;
+
+/*
+ * LED driver. Power is removed after TLC5926_Shutdown(), so the outputs are
+ * treated as blank until the next bitmap is shifted in.
+ */
+void TLC5926_init(void)
+{
+    TLC5926_SetLights(0);
+}
+
+void TLC5926_SetLights(uint16_t bitmap)
+{
+    lights = bitmap;
+    replay_lights(lights, brightness);
+}
+
+void TLC5926_SetBrightness(uint8_t duty)
+{
+    brightness = duty;
+    replay_lights(lights, brightness);
+}
+
+bool TLC5926_IsDimmed(void)
+{
+    return brightness != TLC5926_BRIGHTNESS_OFF &&
+            brightness != TLC5926_BRIGHTNESS_FULL;
+}
+
+void TLC5926_Shutdown(void)
+{
+    TLC5926_SetLights(0);
+}
+
+/*
+ * EEPROM, which starts erased
+ */
+unsigned char eeprom_read_register(unsigned char address)
+{
+    uint16_t i;
+
+    if (eepromErased == false)
+    {
+        for (i = 0; i < sizeof(eeprom); i++)
+            eeprom[i] = 0xFF;
+        eepromErased = true;
+    }
+
+    return eeprom[address];
+}
+
+void eeprom_write_register(unsigned char address, unsigned char data)
+{
+    eeprom_read_register(address);
+    eeprom[address] = data;
+}
+
+/*
+ * UART, which is always idle since telemetry is reported directly
+ */
+void UART_tx_isr(void)
+{
+}
+
+bool UART_tx_idle(void)
+{
+    return true;
+}
+
+void UART_flush(void)
+{
+}
+
+void UART_set_brg(uint16_t brg)
+{
+}
+
+/*
+ * Fuel gauge, which reads the battery from the trace
+ */
+void battery_init(void)
+{
+}
+
+uint16_t battery_measure(void)
+{
+    return replayBatteryMillivolts;
+}
+
+uint16_t battery_millivolts(void)
+{
+    return replayBatteryMillivolts;
+}
+
+uint8_t battery_percent(void)
+{
+    return replayBatteryPercent;
+}
+
+/*
+ * Telemetry, reported as text instead of framed records
+ */
+void telemetry_init(void)
+{
+}
+
+void telemetry_reading(uint16_t reading)
+{
+    replay_reading(reading);
+}
+
+void telemetry_state(uint8_t appState)
+{
+    replay_state(appState);
+}
+
+void telemetry_battery(uint16_t millivolts, uint8_t percent)
+{
+    replay_log("BATTERY %u mV (%u%%)", millivolts, percent);
+}
+
+void telemetry_calibration(uint8_t calibType, uint8_t result, uint16_t reading)
+{
+    replay_log("CALIBRATION %s %s %u", calibTypes[calibType % 3],
+            calibResults[result % 3], reading);
+}
+
+void telemetry_error(uint8_t code)
+{
+    replay_log("ERROR %u", code);
+}
+
+void telemetry_event(uint8_t type, uint16_t value)
+{
+    replay_log("EVENT 0x%02X %u", type, value);
+}
+
+void telemetry_power(uint8_t domain, uint32_t ms)
+{
+    replay_log("POWER %s %lu ms", powerDomains[domain % 4],
+            (unsigned long) ms);
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+Decode Park Light telemetry captured from the UART (19200 8N1).
+
+Each record is COBS framed and terminated by 0x00. Decoded, a record is
+a type byte, a little endian payload and a CRC-8 (polynomial 0x07) over
+the type and payload. See telemetry.h for the record types.
+
+Usage:
+    telemetry_decode.py capture.bin
+    telemetry_decode.py < /dev/ttyUSB0
+"""
+
+import struct
+import sys
+
+APP_STATES = {
+    0: "DISPLAY",
+    1: "STANDBY",
+    2: "CALIB",
+    3: "ENTER_DISPLAY",
+    4: "ENTER_STANDBY",
+    5: "ENTER_CALIB",
+    6: "INDEFINITE_SLEEP",
+}
+
+CALIB_TYPES = {0: "NONE", 1: "YELLOW", 2: "RED"}
+CALIB_RESULTS = {0: "OK", 1: "UNSTABLE", 2: "TOO_CLOSE"}
+ERRORS = {1: "NO_READING", 2: "STANDBY"}
+
+# Flight recorder events, see recorder.h
+RESET_CAUSES = ["POWER_ON", "BROWN_OUT", "WATCHDOG", "MCLR", "INSTRUCTION",
+                "STACK"]
+DUMP_SOURCES = {0: "RAM", 1: "EEPROM"}
+
+# Profiled regions and statistics, see profile.h
+PROFILE_REGIONS = {0: "ISR", 1: "SET_LIGHTS", 2: "DB_SAVE", 3: "MAIN_LOOP"}
+PROFILE_REGIONS.update({4 + state: "STATE_" + name
+                        for state, name in APP_STATES.items()})
+PROFILE_STATS = {0: "count", 1: "min", 2: "max", 3: "total"}
+
+# Power domains by bit number, see power.h
+POWER_DOMAINS = {0: "SENSOR", 1: "LEDS", 2: "ADC", 3: "TOTAL"}
+
+
+def describe_event(event, value):
+    if event == 0x01:
+        causes = [name for bit, name in enumerate(RESET_CAUSES)
+                  if value & (1 << bit)]
+        return "RESET %s" % ("|".join(causes) or "NONE")
+    if event == 0x02:
+        return "READING %u us (%.1f cm)" % (value, value / US_PER_CM)
+    if event == 0x03:
+        return "STATE %s" % APP_STATES.get(value, value)
+    if event == 0x04:
+        return "BATTERY %u mV" % value
+    if event == 0x05:
+        return "ERROR %s" % ERRORS.get(value, value)
+    if event == 0x06:
+        return "DUMP from %s" % DUMP_SOURCES.get(value, value)
+    return "0x%02X %u" % (event, value)
+
+US_PER_CM = 58
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame) + 1:
+            raise ValueError("bad COBS code")
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def describe(record):
+    kind, payload = record[0], record[1:]
+
+    if kind == 0x01:
+        (reading,) = struct.unpack("<H", payload)
+        return "READING %u us (%.1f cm)" % (reading, reading / US_PER_CM)
+    if kind == 0x02:
+        return "STATE %s" % APP_STATES.get(payload[0], payload[0])
+    if kind == 0x03:
+        millivolts, percent = struct.unpack("<HB", payload)
+        return "BATTERY %u mV (%u%%)" % (millivolts, percent)
+    if kind == 0x04:
+        calib, result, reading = struct.unpack("<BBH", payload)
+        return "CALIBRATION %s %s %u us" % (CALIB_TYPES.get(calib, calib),
+                                            CALIB_RESULTS.get(result, result),
+                                            reading)
+    if kind == 0x05:
+        return "ERROR %s" % ERRORS.get(payload[0], payload[0])
+    if kind == 0x06:
+        event, value = struct.unpack("<BH", payload)
+        return "EVENT %s" % describe_event(event, value)
+    if kind == 0x07:
+        region, stat, value = struct.unpack("<BBI", payload)
+        unit = "" if stat == 0 else " us"
+        return "PROFILE %s %s %u%s" % (PROFILE_REGIONS.get(region, region),
+                                        PROFILE_STATS.get(stat, stat),
+                                        value, unit)
+    if kind == 0x08:
+        domain, ms = struct.unpack("<BI", payload)
+        return "POWER %s %u ms" % (POWER_DOMAINS.get(domain, domain), ms)
+
+    return "UNKNOWN type 0x%02X %s" % (kind, payload.hex())
+
+
+def decode(stream):
+    for frame in stream.split(b"\x00"):
+        if not frame:
+            continue
+        try:
+            record = cobs_decode(frame)
+        except ValueError:
+            yield "BAD FRAME %s" % frame.hex()
+            continue
+        if len(record) < 2 or crc8(record[:-1]) != record[-1]:
+            yield "BAD CRC %s" % record.hex()
+            continue
+        try:
+            yield describe(record[:-1])
+        except (struct.error, IndexError):
+            yield "BAD LENGTH %s" % record.hex()
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as capture:
+            data = capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    for line in decode(data):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
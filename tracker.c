@@ -0,0 +1,220 @@
+/* 
+ * File:   tracker.c
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:22 AM
+ * 
+ * Alpha-beta filter estimating the echo time and how fast it is changing.
+ * The PIC16 has no hardware multiply or divide, so the state is kept in 16 
+ * bits and everything is done with adds and shifts. Gains are powers of two,
+ * and the reading period, which changes with the speed of the car and the 
+ * power policy, is scaled through a table of period buckets.
+ */
+
+#include "tracker.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Position in echo microseconds, and velocity in echo microseconds per 
+// 2^TRACKER_VEL_SHIFT ms
+static int16_t position = 0;
+static int16_t velocity = 0;
+static bool valid = false;
+
+// A reading period scaled by a factor of two shifted terms, the second added
+// or, when negative, subtracted
+typedef struct
+{
+    uint16_t longest;       // Longest period in the bucket in ms
+    uint8_t advance;        // Period / 2^TRACKER_VEL_SHIFT ms
+    int8_t advanceTerm;
+    uint8_t gain;           // 32ms / period
+    int8_t gainTerm;
+} tracker_bucket;
+
+// Buckets around the display reading periods, 40, 100 and 200ms stretched by
+// the power policy. Each is centred on the nearest period the shifts give 
+// exactly. The velocity settles on whatever makes the advance over the 
+// bucket's period match the readings, so the prediction holds for a steady 
+// period and the few percent left in the gains only changes beta a little.
+static const tracker_bucket buckets[] = {
+    {56,    5, 7,   0, -2},     // 40ms
+    {88,    4, 6,   1, -3},     // 80ms
+    {108,   3, -5,  2, 4},      // 96ms
+    {140,   3, -7,  2, 6},      // 120ms
+    {176,   3, 5,   2, -4},     // 160ms
+    {240,   2, -4,  3, 5},      // 192ms
+    {336,   2, 5,   3, -6},     // 288ms
+    {480,   1, -3,  4, 6},      // 384ms
+    {672,   1, 4,   4, -7},     // 576ms
+    {UINT16_MAX, 0, -2, 5, 7},  // 768ms
+};
+
+#if TRACKER_VEL_SHIFT != 10
+#error "The bucket shifts are worked out for TRACKER_VEL_SHIFT 10"
+#endif
+
+// The gains are per 32ms, so the residual is scaled up to the velocity units
+// and down by beta
+#define TRACKER_GAIN_SHIFT  (TRACKER_VEL_SHIFT - 5 - TRACKER_BETA_SHIFT)
+
+#if TRACKER_GAIN_SHIFT < 0
+#error "TRACKER_BETA_SHIFT is too large for TRACKER_VEL_SHIFT"
+#endif
+
+/*
+ * tracker_reset
+ * 
+ * Forget the current estimate. The next reading starts the filter again.
+ */
+void tracker_reset(void)
+{
+    valid = false;
+}
+
+/*
+ * tracker_bucket_for
+ * 
+ * Input:
+ *      period      Reading period in milliseconds
+ * 
+ * Output:
+ *      The bucket the period falls in
+ */
+static const tracker_bucket *tracker_bucket_for(uint16_t period)
+{
+    const tracker_bucket *bucket = buckets;
+    
+    while (period > bucket->longest)
+        bucket++;
+    
+    return bucket;
+}
+
+/*
+ * tracker_scale
+ * 
+ * Output:
+ *      value >> shift, plus or minus value >> |term|
+ */
+static int16_t tracker_scale(int16_t value, uint8_t shift, int8_t term)
+{
+    if (term < 0)
+        return (value >> shift) - (value >> -term);
+    
+    return (value >> shift) + (value >> term);
+}
+
+/*
+ * tracker_move
+ * 
+ * Output:
+ *      position moved by change, kept between 0 and INT16_MAX
+ */
+static int16_t tracker_move(int16_t position, int16_t change)
+{
+    if (change > 0 && position > INT16_MAX - change)
+        return INT16_MAX;
+    
+    position += change;
+    if (position < 0)
+        return 0;
+    
+    return position;
+}
+
+/*
+ * tracker_update
+ * 
+ * Correct the estimate with a new reading.
+ * 
+ * Input:
+ *      reading     Echo time in microseconds
+ *      period      Time since the last reading in milliseconds
+ */
+void tracker_update(uint16_t reading, uint16_t period)
+{
+    const tracker_bucket *bucket;
+    int16_t residual;
+    
+    if (valid == false)
+    {
+        position = (int16_t) reading;
+        velocity = 0;
+        valid = true;
+        return;
+    }
+    
+    // Predict forward over the period and correct by a fraction of the error.
+    // The velocity correction is spread over the period it built up in.
+    bucket = tracker_bucket_for(period);
+    position = tracker_move(position, 
+            tracker_scale(velocity, bucket->advance, bucket->advanceTerm));
+    residual = (int16_t) reading - position;
+    position += residual >> TRACKER_ALPHA_SHIFT;
+    
+    if (residual > TRACKER_MAX_RESIDUAL)
+        residual = TRACKER_MAX_RESIDUAL;
+    else if (residual < -TRACKER_MAX_RESIDUAL)
+        residual = -TRACKER_MAX_RESIDUAL;
+    
+    velocity += tracker_scale(residual << TRACKER_GAIN_SHIFT, bucket->gain, 
+            bucket->gainTerm);
+    if (velocity > TRACKER_MAX_VELOCITY)
+        velocity = TRACKER_MAX_VELOCITY;
+    else if (velocity < -TRACKER_MAX_VELOCITY)
+        velocity = -TRACKER_MAX_VELOCITY;
+}
+
+/*
+ * tracker_valid
+ * 
+ * Output:
+ *      true once the filter has seen a reading since the last reset
+ */
+bool tracker_valid(void)
+{
+    return valid;
+}
+
+/*
+ * tracker_position
+ * 
+ * Output:
+ *      Filtered echo time in microseconds
+ */
+uint16_t tracker_position(void)
+{
+    return (uint16_t) position;
+}
+
+/*
+ * tracker_predict
+ * 
+ * Input:
+ *      period      Time until the next reading in milliseconds
+ * 
+ * Output:
+ *      Echo time in microseconds expected at the next reading
+ */
+uint16_t tracker_predict(uint16_t period)
+{
+    const tracker_bucket *bucket = tracker_bucket_for(period);
+    
+    return (uint16_t) tracker_move(position, 
+            tracker_scale(velocity, bucket->advance, bucket->advanceTerm));
+}
+
+/*
+ * tracker_velocity
+ * 
+ * Output:
+ *      Change in echo time per 100ms in microseconds, negative while the 
+ *      car approaches.
+ */
+int16_t tracker_velocity(void)
+{
+    // 100 / 1024 = 1/16 + 1/32 + 1/256
+    return (velocity >> 4) + (velocity >> 5) + (velocity >> 8);
+}
@@ -0,0 +1,38 @@
+/* 
+ * File:   tracker.h
+ * Author: Merrick
+ *
+ * Created on 17 October 2026, 11:22 AM
+ */
+
+#ifndef TRACKER_H
+#define	TRACKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Let the display state change towards red on the predicted position
+#ifndef TRACKER_PREDICTION
+#define TRACKER_PREDICTION  1
+#endif
+
+// Filter gains as shifts, alpha = 1/2 and beta = 1/8
+#define TRACKER_ALPHA_SHIFT 1
+#define TRACKER_BETA_SHIFT  3
+
+// Velocity in echo microseconds per 2^n milliseconds
+#define TRACKER_VEL_SHIFT   10
+
+// Largest residual the velocity is corrected by, and the largest velocity, 
+// in echo microseconds. These keep the 16 bit sums in range.
+#define TRACKER_MAX_RESIDUAL    2048
+#define TRACKER_MAX_VELOCITY    24576   // ~4m/s
+
+void tracker_reset(void);
+void tracker_update(uint16_t reading, uint16_t period);
+bool tracker_valid(void);
+uint16_t tracker_position(void);
+uint16_t tracker_predict(uint16_t period);
+int16_t tracker_velocity(void);
+
+#endif	/* TRACKER_H */
@@ -14,11 +14,18 @@
 #include <htc.h>
 #include <pic16f1828.h>
 
+#define UART_TX_QUEUE_MASK  (UART_TX_QUEUE_LEN - 1)
+
+// Transmit queue. The head is only written by the main loop and the tail only
+// by the ISR, so neither needs interrupts disabled.
+static volatile uint8_t txQueue[UART_TX_QUEUE_LEN];
+static volatile uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+
 char UART_init(const long int baudrate, const long int clock, bool transmit, bool receive)
 {
     unsigned int x;
-    SPBRG = (clock - baudrate*16)/(baudrate*16); //SPBRG for High Baud Rate
-    BRGH = 1;
+    UART_set_brg(UART_BRG(clock, baudrate));      // 16-bit BRG, as clock_set() reloads it
 
     SYNC = 0;                                     // Setting Asynchronous Mode, ie UART
     SPEN = 1;                                     // Enables Serial Port    
@@ -32,6 +39,23 @@ char UART_init(const long int baudrate, const long int clock, bool transmit, boo
                                 // Returns 0 to indicate UART initialization failed
 }
 
+/*
+ * UART_set_brg
+ * 
+ * Reload the baud rate generator for a new clock speed. Only call while the
+ * transmitter is idle.
+ * 
+ * Input:
+ *      brg     UART_BRG() for the new clock
+ */
+void UART_set_brg(uint16_t brg)
+{
+    BAUDCONbits.BRG16 = 1;
+    BRGH = 1;
+    SPBRGH = (uint8_t) (brg >> 8);
+    SPBRGL = (uint8_t) brg;
+}
+
 void UART_write(char data)
 {
     while(!TRMT);
@@ -53,6 +77,87 @@ void UART_write_text(const char *text)
     }
 }
 
+/*
+ * UART_enqueue
+ * 
+ * Queue a message for transmission by the TXIF interrupt and return 
+ * immediately. Messages are never split: if the whole message doesn't fit, 
+ * it is dropped.
+ * 
+ * Input:
+ *      data    Bytes to send
+ *      len     Number of bytes
+ * 
+ * Output:
+ *      true if the message was queued, false if it was dropped
+ */
+bool UART_enqueue(const uint8_t *data, uint8_t len)
+{
+    uint8_t head = txHead;
+    uint8_t used = (uint8_t) (head - txTail) & UART_TX_QUEUE_MASK;
+    
+    // One slot is kept empty to tell a full queue from an empty one
+    if (len > (UART_TX_QUEUE_MASK - used))
+        return false;
+    
+    while (len--)
+    {
+        txQueue[head] = *data++;
+        head = (head + 1) & UART_TX_QUEUE_MASK;
+    }
+    txHead = head;
+    
+    // Start the transmitter
+    PIE1bits.TXIE = 1;
+    
+    return true;
+}
+
+/*
+ * UART_tx_isr
+ * 
+ * Move the next queued byte into TXREG. Call from the ISR when TXIF is set 
+ * and TXIE is enabled. The interrupt is disabled once the queue is empty.
+ */
+void UART_tx_isr(void)
+{
+    uint8_t tail = txTail;
+    
+    if (tail == txHead)
+    {
+        PIE1bits.TXIE = 0;
+        return;
+    }
+    
+    TXREG = txQueue[tail];
+    txTail = (tail + 1) & UART_TX_QUEUE_MASK;
+}
+
+/*
+ * UART_tx_idle
+ * 
+ * Output:
+ *      true when the queue is empty and the last byte has left the shift
+ *      register.
+ */
+bool UART_tx_idle(void)
+{
+    return (txHead == txTail) && TRMT;
+}
+
+/*
+ * UART_flush
+ * 
+ * Wait for the transmit queue to drain. The baud rate generator stops in 
+ * SLEEP, so this must be called before sleeping or the byte being shifted out
+ * is corrupted.
+ */
+void UART_flush(void)
+{
+    while (!UART_tx_idle())
+        CLRWDT();
+}
+
 char UART_data_ready()
 {
     return RCIF;
@@ -9,9 +9,21 @@
 #define	UART_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+// Size of the interrupt driven transmit queue. Must be a power of two.
+#define UART_TX_QUEUE_LEN   32
+
+// SPBRG for a baud rate with BRG16 and BRGH set, F_osc / (4 * (SPBRG + 1))
+#define UART_BRG(clock, baud)   ((uint16_t) ((clock) / (4ul * (baud)) - 1))
 
 char UART_init(const long int baudrate,  const long int clock, bool transmit, bool receive);
+void UART_set_brg(uint16_t brg);
 void UART_write_text(const char *text);
+bool UART_enqueue(const uint8_t *data, uint8_t len);
+void UART_tx_isr(void);
+bool UART_tx_idle(void);
+void UART_flush(void);
 char UART_data_ready();
 //void UART_read_text(char *output, unsigned int length);
 
@@ -7,8 +7,6 @@
 
 #include "utils.h"
 
-#include <string.h>
-
 void circular_increment_counter(uint8_t *cnt, uint8_t max)
 {   
     (*cnt)++;
@@ -16,59 +14,147 @@ void circular_increment_counter(uint8_t *cnt, uint8_t max)
         *cnt = 0;
 }
 
-void swap(uint8_t *a, uint8_t *b)
+/*
+ * median3, median5, median7, median9
+ * 
+ * Median of a window using a pruned sorting network, with each 
+ * compare-exchange inline. The input is left untouched.
+ * 
+ * Compare-exchanges: 3, 7, 13 and 19 respectively.
+ * 
+ * Input:
+ *      buf     Window of readings
+ * 
+ * Output:
+ *      The median
+ */
+uint16_t median3(const uint16_t *buf)
 {
-	uint8_t tmp = *b;
-	*b = *a;
-	*a = tmp;
+    uint16_t p[3];
+    
+    p[0] = buf[0]; p[1] = buf[1]; p[2] = buf[2];
+    
+    CMP_SWAP(p[0], p[1]); CMP_SWAP(p[1], p[2]); CMP_SWAP(p[0], p[1]);
+    return p[1];
 }
 
-uint8_t fastMedian5(uint8_t *buf)
+uint16_t median5(const uint16_t *buf)
 {
-    uint8_t arr[5] = {0};
+    uint16_t p[5];
     
-    // Put the numbers in an array
-    memcpy(arr, buf, (size_t) 5);
+    p[0] = buf[0]; p[1] = buf[1]; p[2] = buf[2]; p[3] = buf[3]; p[4] = buf[4];
+    
+    CMP_SWAP(p[0], p[1]); CMP_SWAP(p[3], p[4]); CMP_SWAP(p[0], p[3]);
+    CMP_SWAP(p[1], p[4]); CMP_SWAP(p[1], p[2]); CMP_SWAP(p[2], p[3]);
+    CMP_SWAP(p[1], p[2]);
+    return p[2];
+}
+
+uint16_t median7(const uint16_t *buf)
+{
+    uint16_t p[7];
+    uint8_t i;
+    
+    for (i = 0; i < 7; i++)
+        p[i] = buf[i];
+    
+    CMP_SWAP(p[0], p[5]); CMP_SWAP(p[0], p[3]); CMP_SWAP(p[1], p[6]);
+    CMP_SWAP(p[2], p[4]); CMP_SWAP(p[0], p[1]); CMP_SWAP(p[3], p[5]);
+    CMP_SWAP(p[2], p[6]); CMP_SWAP(p[2], p[3]); CMP_SWAP(p[3], p[6]);
+    CMP_SWAP(p[4], p[5]); CMP_SWAP(p[1], p[4]); CMP_SWAP(p[1], p[3]);
+    CMP_SWAP(p[3], p[4]);
+    return p[3];
+}
+
+uint16_t median9(const uint16_t *buf)
+{
+    uint16_t p[9];
+    uint8_t i;
     
-    // Ensure a[0] < a[1], a[0] < a[3], a[3] < a[4]
-    if (arr[0] > arr[1]) swap(&arr[0], &arr[1]);
-    if (arr[3] > arr[4]) swap(&arr[3], &arr[4]);
-    if (arr[0] > arr[3]) {
-    	swap(&arr[0], &arr[3]);
-    	swap(&arr[1], &arr[4]);
-    }
+    for (i = 0; i < 9; i++)
+        p[i] = buf[i];
     
-    if (arr[2] > arr[1]) {
-    	if (arr[1] < arr[3]) {
-    		if (arr[2] < arr[3])
-                return arr[2];
-            else
-                return arr[3];
-        } else {
-            if (arr[1] < arr[4])
-                return arr[1];
-            else
-                return arr[4];
-        }
-    } else {
-    	if (arr[2] > arr[3]) {
-    		if (arr[2] < arr[4])
-                return arr[2];
-            else 
-                return arr[4];
-        } else {
-            if (arr[1] < arr[3])
-                return arr[1];
-            else 
-                return arr[3];
-        }
-    }
+    CMP_SWAP(p[1], p[2]); CMP_SWAP(p[4], p[5]); CMP_SWAP(p[7], p[8]);
+    CMP_SWAP(p[0], p[1]); CMP_SWAP(p[3], p[4]); CMP_SWAP(p[6], p[7]);
+    CMP_SWAP(p[1], p[2]); CMP_SWAP(p[4], p[5]); CMP_SWAP(p[7], p[8]);
+    CMP_SWAP(p[0], p[3]); CMP_SWAP(p[5], p[8]); CMP_SWAP(p[4], p[7]);
+    CMP_SWAP(p[3], p[6]); CMP_SWAP(p[1], p[4]); CMP_SWAP(p[2], p[5]);
+    CMP_SWAP(p[4], p[7]); CMP_SWAP(p[4], p[2]); CMP_SWAP(p[6], p[4]);
+    CMP_SWAP(p[4], p[2]);
+    return p[4];
 }
 
-uint8_t absdiff(uint8_t a, uint8_t b) 
+/*
+ * min3 ... max9
+ * 
+ * Minimum and maximum of a window, n - 1 compares each.
+ */
+#define DEFINE_MIN_MAX(n) \
+uint16_t min##n(const uint16_t *buf) \
+{ \
+    uint16_t m = buf[0]; \
+    uint8_t i; \
+    for (i = 1; i < n; i++) \
+        if (buf[i] < m) \
+            m = buf[i]; \
+    return m; \
+} \
+uint16_t max##n(const uint16_t *buf) \
+{ \
+    uint16_t m = buf[0]; \
+    uint8_t i; \
+    for (i = 1; i < n; i++) \
+        if (buf[i] > m) \
+            m = buf[i]; \
+    return m; \
+}
+
+DEFINE_MIN_MAX(3)
+DEFINE_MIN_MAX(5)
+DEFINE_MIN_MAX(7)
+DEFINE_MIN_MAX(9)
+
+uint16_t absdiff(uint16_t a, uint16_t b) 
 {
     if (a > b)
         return a-b;
     else
         return b-a;
-}
\ No newline at end of file
+}
+
+/*
+ * hampel
+ * 
+ * Hampel outlier filter over a window of FILTER_LEN readings. The sample is 
+ * replaced by the window median if it is further from it than 4 median 
+ * absolute deviations (~3 standard deviations), so steady movement passes 
+ * through untouched but a single bad echo doesn't.
+ * 
+ * Input:
+ *      window      The last FILTER_LEN readings, including the sample
+ *      sample      The newest reading
+ *      minThresh   Smallest deviation treated as an outlier
+ * 
+ * Output:
+ *      The sample, or the window median if the sample is an outlier
+ */
+uint16_t hampel(const uint16_t *window, uint16_t sample, uint16_t minThresh)
+{
+    uint16_t deviations[FILTER_LEN];
+    uint16_t median = MEDIAN_N(FILTER_LEN)(window);
+    uint16_t thresh;
+    uint8_t i;
+    
+    for (i = 0; i < FILTER_LEN; i++)
+        deviations[i] = absdiff(window[i], median);
+    
+    thresh = MEDIAN_N(FILTER_LEN)(deviations);
+    thresh = (thresh > (UINT16_MAX >> 2)) ? UINT16_MAX : (uint16_t) (thresh << 2);
+    if (thresh < minThresh)
+        thresh = minThresh;
+    
+    if (absdiff(sample, median) > thresh)
+        return median;
+    else
+        return sample;
+}
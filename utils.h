@@ -10,9 +10,47 @@
 
 #include <stdint.h>
 
+// Number of readings filtered for standby, calibration and the display. 
+// Must be one of the sizes with a median network below: 3, 5, 7 or 9.
+#ifndef FILTER_LEN
+#define FILTER_LEN 5
+#endif
+
+#if FILTER_LEN != 3 && FILTER_LEN != 5 && FILTER_LEN != 7 && FILTER_LEN != 9
+#error "FILTER_LEN must be 3, 5, 7 or 9"
+#endif
+
+// Inline compare-exchange, leaves the smaller value in a. tools/median 
+// defines its own to count them.
+#ifndef CMP_SWAP
+#define CMP_SWAP(a, b)  do { if ((a) > (b)) { uint16_t t_ = (a); (a) = (b); (b) = t_; } } while (0)
+#endif
+
+// Select the median/min/max function for a window size, e.g. 
+// MEDIAN_N(FILTER_LEN)(readings). The extra level lets n be a macro.
+#define MEDIAN_N(n)     MEDIAN_N_(n)
+#define MEDIAN_N_(n)    median##n
+#define MIN_N(n)        MIN_N_(n)
+#define MIN_N_(n)       min##n
+#define MAX_N(n)        MAX_N_(n)
+#define MAX_N_(n)       max##n
+
+// Declare the min and max of n for one window size
+#define DECLARE_MIN_MAX(n) \
+    uint16_t min##n(const uint16_t *buf); \
+    uint16_t max##n(const uint16_t *buf);
+
 void circular_increment_counter(uint8_t *cnt, uint8_t max);
-uint8_t fastMedian5(uint8_t *buf);
-uint8_t absdiff(uint8_t a, uint8_t b);
+uint16_t median3(const uint16_t *buf);
+uint16_t median5(const uint16_t *buf);
+uint16_t median7(const uint16_t *buf);
+uint16_t median9(const uint16_t *buf);
+DECLARE_MIN_MAX(3)
+DECLARE_MIN_MAX(5)
+DECLARE_MIN_MAX(7)
+DECLARE_MIN_MAX(9)
+uint16_t absdiff(uint16_t a, uint16_t b);
+uint16_t hampel(const uint16_t *window, uint16_t sample, uint16_t minThresh);
 
 #endif	/* UTILS_H */
 